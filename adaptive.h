@@ -0,0 +1,161 @@
+
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+// needs eo and evaluate.h to be included before
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+// Adaptive operator selection by probability matching (Thierens 2005).
+// Mutations applied in a generation are credited with improvement of their
+// offspring over the offspring as crossed, per cost of the offspring:
+// evaluations of its mutation and evaluation, or thread CPU nanoseconds.
+// Crossover is credited apart, with improvement of crossed offspring over
+// its parent, and only logged as its rate is pCross. At end of generation
+// quality of each applied mutation moves toward its credit per cost by
+// adaptation rate, and rates of mutations become
+//
+//     minRate + (1 - mutations * minRate) * quality / sum of qualities
+//
+// so no mutation is ever left out. Until a mutation has made progress,
+// configured rates are kept. Rates and credits of each generation are
+// logged as a csv row.
+
+// improvement of child over its parent, as EO fitness compares worse < better
+template <class EOT>
+double operatorCredit(const EOT& parent, const EOT& child)
+{
+    if (! (parent.fitness() < child.fitness()))
+        return 0;
+    return fabs(double(child.fitness()) - double(parent.fitness()));
+}
+
+class hadOperatorSelector : public eoFunctorBase, public eoPersistent
+{
+public:
+    enum Cost { Evaluations, Time };
+
+    Cost cost;
+    vector<double> rates;
+
+    hadOperatorSelector(const vector<string>& _names, const vector<double>& _rates, double _minRate, double _adaptation, Cost _cost)
+        : cost(_cost), rates(_rates), names(_names), minRate(min(_minRate, 1.0 / _rates.size())), adaptation(_adaptation), crossoverCredit(0), crossoverCost(0), file(0)
+    {
+        qualities.assign(rates.size(), 0);
+        credits.assign(rates.size(), 0);
+        costs.assign(rates.size(), 0);
+    }
+
+    ~hadOperatorSelector()
+    {
+        if (file) fclose(file);
+    }
+
+    // appends to rows of a resumed run
+    bool open(const char* filename, bool append = false)
+    {
+        file = fopen(filename, append ? "a" : "w");
+        if (! file) return false;
+
+        if (! append || ftell(file) == 0)
+        {
+            fprintf(file, "generation");
+            for (size_t i = 0; i < names.size(); i++)
+                fprintf(file, ",%sRate", names[i].c_str());
+            for (size_t i = 0; i < names.size(); i++)
+                fprintf(file, ",%sCredit", names[i].c_str());
+            fprintf(file, ",crossoverCredit\n");
+        }
+        fflush(file);
+        return true;
+    }
+
+    // cost of work of a thread so far, in unit of cost
+    double clock(House* house) const
+    {
+        if (cost == Evaluations)
+            return house->evaluations;
+
+        timespec t;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+        return t.tv_sec * 1e9 + t.tv_nsec;
+    }
+
+    // an offspring of mutation, with its improvement and cost
+    void credit(int mutation, double improvement, double work)
+    {
+        credits[mutation] += improvement;
+        costs[mutation] += max(work, 1.0);
+    }
+
+    // a crossed offspring, with its improvement and cost of its evaluation
+    void creditCrossover(double improvement, double work)
+    {
+        crossoverCredit += improvement;
+        crossoverCost += max(work, 1.0);
+    }
+
+    // end of generation
+    void update(unsigned long generation)
+    {
+        double sum = 0;
+        for (size_t i = 0; i < rates.size(); i++)
+        {
+            if (costs[i] > 0)
+                qualities[i] += adaptation * (credits[i] / costs[i] - qualities[i]);
+            sum += qualities[i];
+        }
+
+        if (sum > 0)
+            for (size_t i = 0; i < rates.size(); i++)
+                rates[i] = minRate + (1 - rates.size() * minRate) * qualities[i] / sum;
+
+        if (file)
+        {
+            fprintf(file, "%lu", generation);
+            for (size_t i = 0; i < rates.size(); i++)
+                fprintf(file, ",%.6f", rates[i]);
+            for (size_t i = 0; i < rates.size(); i++)
+                fprintf(file, ",%.6g", costs[i] > 0 ? credits[i] / costs[i] : 0);
+            fprintf(file, ",%.6g\n", crossoverCost > 0 ? crossoverCredit / crossoverCost : 0);
+            fflush(file);
+        }
+
+        credits.assign(rates.size(), 0);
+        costs.assign(rates.size(), 0);
+        crossoverCredit = crossoverCost = 0;
+    }
+
+    void printOn(ostream& os) const
+    {
+        os << rates.size();
+        for (size_t i = 0; i < rates.size(); i++)
+            os << ' ' << rates[i] << ' ' << qualities[i];
+    }
+
+    void readFrom(istream& is)
+    {
+        size_t size;
+        is >> size;
+        if (size != rates.size())
+        {
+            is.setstate(ios::failbit);
+            return;
+        }
+        for (size_t i = 0; i < size; i++)
+            is >> rates[i] >> qualities[i];
+    }
+
+    string className() const { return "hadOperatorSelector"; }
+
+private:
+    vector<string> names;
+    double minRate, adaptation;
+    vector<double> qualities, credits, costs;
+    double crossoverCredit, crossoverCost;
+    FILE* file;
+};
+
+#endif
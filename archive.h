@@ -0,0 +1,467 @@
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+// needs moeo to be included before
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+// Pareto archive of at most capacity individuals, 0 for unbounded. Archived
+// objective vectors are indexed by an ND-tree: nodes keep ideal and nadir
+// points of their subtree, so an insert visits only nodes whose box may
+// dominate the new vector or be dominated by it. Beyond capacity, most
+// crowded individuals are dropped, as in NSGA-II truncation.
+//
+// Objectives are compared as costs, maximized ones are negated.
+
+template <class MOEOT>
+class hadBoundedArchive : public moeoArchive<MOEOT>
+{
+public:
+    typedef typename MOEOT::ObjectiveVector ObjectiveVector;
+
+    hadBoundedArchive(unsigned _capacity = 0)
+        : capacity(_capacity), dimension(ObjectiveVector::nObjectives()), root(0)
+    {}
+
+    ~hadBoundedArchive()
+    {
+        if (root) destroy(root);
+    }
+
+    string className() const { return "hadBoundedArchive"; }
+
+    bool operator()(const MOEOT& moeo)
+    {
+        bool changed = insert(moeo);
+        prune();
+        return changed;
+    }
+
+    bool operator()(const eoPop<MOEOT>& pop)
+    {
+        bool changed = false;
+        for (size_t i = 0; i < pop.size(); i++)
+            changed = insert(pop[i]) || changed;
+        prune();
+        return changed;
+    }
+
+    // true if an archived vector dominates given one
+    bool dominates(const ObjectiveVector& objectiveVector) const
+    {
+        vector<double> p = cost(objectiveVector);
+        return root && dominated(root, &p[0]);
+    }
+
+    // index is rebuilt from resumed individuals
+    void readFrom(istream& is)
+    {
+        eoPop<MOEOT>::readFrom(is);
+
+        eoPop<MOEOT> individuals;
+        individuals.swap(*this);
+        reset();
+        (*this)(individuals);
+    }
+
+private:
+    struct Node {
+        Node* parent;
+        vector<Node*> children;
+        vector<int> points; // of leaves, indices of archive
+        vector<double> ideal, nadir;
+    };
+
+    static const size_t leafSize = 20;
+
+    unsigned capacity;
+    size_t dimension;
+    Node* root;
+    vector<double> costs; // dimension values per archived individual
+    vector<Node*> leaves; // leaf of each archived individual
+    vector<int> removed; // waiting for compaction
+
+    hadBoundedArchive(const hadBoundedArchive&);
+    hadBoundedArchive& operator=(const hadBoundedArchive&);
+
+    vector<double> cost(const ObjectiveVector& objectiveVector) const
+    {
+        vector<double> p(dimension);
+        for (size_t i = 0; i < dimension; i++)
+            p[i] = ObjectiveVector::minimizing(i) ? objectiveVector[i] : -objectiveVector[i];
+        return p;
+    }
+
+    inline const double* point(int index) const
+    {
+        return &costs[dimension * index];
+    }
+
+    // weak dominance of costs
+    inline bool covers(const double* a, const double* b) const
+    {
+        for (size_t i = 0; i < dimension; i++)
+            if (a[i] > b[i]) return false;
+        return true;
+    }
+
+    inline bool equal(const double* a, const double* b) const
+    {
+        for (size_t i = 0; i < dimension; i++)
+            if (a[i] != b[i]) return false;
+        return true;
+    }
+
+    inline double distance(const double* a, const double* b) const
+    {
+        double sum = 0;
+        for (size_t i = 0; i < dimension; i++)
+            sum += (a[i] - b[i]) * (a[i] - b[i]);
+        return sum;
+    }
+
+    // squared distance to center of node box
+    inline double centerDistance(const Node* n, const double* p) const
+    {
+        double sum = 0, d;
+        for (size_t i = 0; i < dimension; i++)
+        {
+            d = (n->ideal[i] + n->nadir[i]) / 2 - p[i];
+            sum += d * d;
+        }
+        return sum;
+    }
+
+    void extend(Node* n, const double* p)
+    {
+        if (n->ideal.empty())
+        {
+            n->ideal.assign(p, p + dimension);
+            n->nadir.assign(p, p + dimension);
+            return;
+        }
+
+        for (size_t i = 0; i < dimension; i++)
+        {
+            n->ideal[i] = min(n->ideal[i], p[i]);
+            n->nadir[i] = max(n->nadir[i], p[i]);
+        }
+    }
+
+
+    // Tree
+
+    bool dominated(const Node* n, const double* p) const
+    {
+        if (! covers(&n->ideal[0], p))
+            return false;
+        if (covers(&n->nadir[0], p) && ! equal(&n->nadir[0], p))
+            return true;
+
+        for (size_t i = 0; i < n->children.size(); i++)
+            if (dominated(n->children[i], p))
+                return true;
+
+        for (size_t i = 0; i < n->points.size(); i++)
+            if (covers(point(n->points[i]), p) && ! equal(point(n->points[i]), p))
+                return true;
+
+        return false;
+    }
+
+    // false if p is covered by an archived point, otherwise removes points
+    // p dominates. Bounds of nodes are not shrunk after removals, they stay
+    // valid as outer bounds.
+    bool update(Node* n, const double* p)
+    {
+        if (covers(&n->nadir[0], p))
+            return false;
+
+        if (covers(p, &n->ideal[0]))
+        {
+            collect(n);
+            detach(n);
+            return true;
+        }
+
+        if (! covers(&n->ideal[0], p) && ! covers(p, &n->nadir[0]))
+            return true;
+
+        if (n->children.empty())
+        {
+            for (size_t k = 0; k < n->points.size(); )
+            {
+                const double* q = point(n->points[k]);
+                if (covers(q, p))
+                    return false;
+
+                if (covers(p, q))
+                {
+                    removed.push_back(n->points[k]);
+                    n->points[k] = n->points.back();
+                    n->points.pop_back();
+                }
+                else
+                    k++;
+            }
+        }
+        else
+            for (size_t k = 0; k < n->children.size(); )
+            {
+                size_t children = n->children.size();
+                if (! update(n->children[k], p))
+                    return false;
+                if (n->children.size() == children)
+                    k++;
+            }
+
+        if (n->points.empty() && n->children.empty())
+            detach(n);
+        return true;
+    }
+
+    void insertPoint(int index)
+    {
+        const double* p = point(index);
+        if (! root)
+        {
+            root = new Node;
+            root->parent = 0;
+        }
+
+        // down to leaf of nearest box center
+        Node* n = root;
+        extend(n, p);
+        while (! n->children.empty())
+        {
+            Node* nearest = n->children[0];
+            for (size_t i = 1; i < n->children.size(); i++)
+                if (centerDistance(n->children[i], p) < centerDistance(nearest, p))
+                    nearest = n->children[i];
+            n = nearest;
+            extend(n, p);
+        }
+
+        n->points.push_back(index);
+        leaves[index] = n;
+        if (n->points.size() > leafSize)
+            split(n);
+    }
+
+    // dimension + 1 children, seeded by points far from each other
+    void split(Node* n)
+    {
+        vector<int> points;
+        points.swap(n->points);
+
+        vector<double> spread(points.size(), 0);
+        for (size_t i = 0; i < points.size(); i++)
+            for (size_t j = 0; j < points.size(); j++)
+                spread[i] += distance(point(points[i]), point(points[j]));
+
+        vector<bool> seeded(points.size(), false);
+        size_t first = max_element(spread.begin(), spread.end()) - spread.begin();
+        fill(spread.begin(), spread.end(), 0.0);
+
+        for (size_t seed = first; n->children.size() < dimension + 1; )
+        {
+            seeded[seed] = true;
+            Node* child = new Node;
+            child->parent = n;
+            extend(child, point(points[seed]));
+            child->points.push_back(points[seed]);
+            leaves[points[seed]] = child;
+            n->children.push_back(child);
+
+            // next seed is farthest on average from seeds
+            double farthest = -1;
+            for (size_t i = 0; i < points.size(); i++)
+                if (! seeded[i])
+                {
+                    spread[i] += distance(point(points[i]), point(points[seed]));
+                    if (spread[i] > farthest) { farthest = spread[i]; seed = i; }
+                }
+            if (farthest < 0) break;
+        }
+
+        for (size_t i = 0; i < points.size(); i++)
+            if (! seeded[i])
+            {
+                const double* p = point(points[i]);
+                Node* nearest = n->children[0];
+                for (size_t j = 1; j < n->children.size(); j++)
+                    if (centerDistance(n->children[j], p) < centerDistance(nearest, p))
+                        nearest = n->children[j];
+
+                extend(nearest, p);
+                nearest->points.push_back(points[i]);
+                leaves[points[i]] = nearest;
+            }
+    }
+
+    // points of subtree into removed
+    void collect(Node* n)
+    {
+        removed.insert(removed.end(), n->points.begin(), n->points.end());
+        for (size_t i = 0; i < n->children.size(); i++)
+            collect(n->children[i]);
+    }
+
+    // removes subtree from its parent and deletes it
+    void detach(Node* n)
+    {
+        if (n == root)
+            root = 0;
+        else
+        {
+            vector<Node*>& siblings = n->parent->children;
+            siblings.erase(find(siblings.begin(), siblings.end(), n));
+        }
+        destroy(n);
+    }
+
+    void destroy(Node* n)
+    {
+        for (size_t i = 0; i < n->children.size(); i++)
+            destroy(n->children[i]);
+        delete n;
+    }
+
+
+    // Archive
+
+    bool insert(const MOEOT& moeo)
+    {
+        vector<double> p = cost(moeo.objectiveVector());
+
+        bool accepted = ! root || update(root, &p[0]);
+        compact();
+        if (! accepted)
+            return false;
+
+        this->push_back(moeo);
+        costs.insert(costs.end(), p.begin(), p.end());
+        leaves.push_back(0);
+        insertPoint(this->size() - 1);
+        return true;
+    }
+
+    // removed individuals replaced by last ones
+    void compact()
+    {
+        sort(removed.begin(), removed.end());
+        for (size_t k = removed.size(); k-- > 0; )
+        {
+            int index = removed[k], last = this->size() - 1;
+            if (index != last)
+            {
+                (*this)[index] = (*this)[last];
+                copy(point(last), point(last) + dimension, costs.begin() + dimension * index);
+
+                Node* leaf = leaves[last];
+                *find(leaf->points.begin(), leaf->points.end(), last) = index;
+                leaves[index] = leaf;
+            }
+
+            this->pop_back();
+            costs.resize(dimension * last);
+            leaves.pop_back();
+        }
+        removed.clear();
+    }
+
+    void reset()
+    {
+        eoPop<MOEOT>::clear();
+        costs.clear();
+        leaves.clear();
+        if (root) destroy(root);
+        root = 0;
+    }
+
+    // drops most crowded individual until archive fits in capacity, only
+    // neighbors of a dropped individual get their crowding updated
+    void prune()
+    {
+        const size_t size = this->size();
+        if (! capacity || size <= capacity)
+            return;
+
+        vector< vector<int> > orders(dimension);
+        vector<double> ranges(dimension), crowding(dimension * size); // share of each objective
+        for (size_t j = 0; j < dimension; j++)
+        {
+            vector<int>& order = orders[j];
+            order.resize(size);
+            for (size_t i = 0; i < size; i++)
+                order[i] = i;
+            ObjectiveLess less = {costs, dimension, j};
+            sort(order.begin(), order.end(), less);
+
+            ranges[j] = costs[dimension * order[size-1] + j] - costs[dimension * order[0] + j];
+            for (size_t k = 0; k < size; k++)
+                crowding[dimension * order[k] + j] = share(order, k, j, ranges[j]);
+        }
+
+        vector<bool> kept(size, true);
+        for (size_t left = size; left > capacity; left--)
+        {
+            int index = -1;
+            double least = 0, c;
+            for (size_t i = 0; i < size; i++)
+                if (kept[i])
+                {
+                    c = 0;
+                    for (size_t j = 0; j < dimension; j++)
+                        c += crowding[dimension * i + j];
+                    if (index < 0 || c < least) { least = c; index = i; }
+                }
+            kept[index] = false;
+
+            for (size_t j = 0; j < dimension; j++)
+            {
+                vector<int>& order = orders[j];
+                size_t k = find(order.begin(), order.end(), index) - order.begin();
+                order.erase(order.begin() + k);
+
+                if (k > 0)
+                    crowding[dimension * order[k-1] + j] = share(order, k-1, j, ranges[j]);
+                if (k < order.size())
+                    crowding[dimension * order[k] + j] = share(order, k, j, ranges[j]);
+            }
+
+            Node* n = leaves[index];
+            n->points.erase(find(n->points.begin(), n->points.end(), index));
+            while (n && n->points.empty() && n->children.empty())
+            {
+                Node* parent = n->parent;
+                detach(n);
+                n = parent;
+            }
+            removed.push_back(index);
+        }
+
+        compact();
+    }
+
+    // crowding of k-th individual of order along objective, extremes are kept
+    double share(const vector<int>& order, size_t k, size_t objective, double range) const
+    {
+        if (k == 0 || k + 1 == order.size())
+            return numeric_limits<double>::infinity();
+        if (range <= 0)
+            return 0;
+        return (costs[dimension * order[k+1] + objective] - costs[dimension * order[k-1] + objective]) / range;
+    }
+
+    struct ObjectiveLess {
+        const vector<double>& costs;
+        size_t dimension, objective;
+        bool operator()(int a, int b) const { return costs[dimension * a + objective] < costs[dimension * b + objective]; }
+    };
+};
+
+#endif
@@ -0,0 +1,1218 @@
+#include <QCoreApplication>
+#include <QtGui/QApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMap>
+#include <QMutex>
+#include <QProcess>
+#include <QRegExp>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+
+#include <iostream>
+
+#include "planviewer.h"
+#include <evaluate.h>
+#include <generations.h>
+#include <instances.h>
+
+// Headless runs of engines for every combination of .param files, seeds and problems
+// usage: batch --params=eo.param,hybrid.param --seeds=1-10 [--problems=problem.json] [--jobs=4] [--out=batch] [--images]
+//
+// or a race of configurations of a .param file over seeds and problems, see Tuning
+// usage: batch --tune=hybrid.param --space=hybrid.space --seeds=1-20 [--problems=instances/r010-s1.json] [--gap=0.05] [--target=-150] [--time=60] [--candidates=20] [--budget=400] [--alpha=0.05] [--jobs=4] [--out=tune]
+//
+// or generated problem instances and a benchmark of engines on them, see Benchmark
+// usage: batch --generate=instances --rooms=5,10,20,50,100,200 [--seeds=1]
+// usage: batch --benchmark=instances --params=eo.param,es.param,hybrid.param,moeo.param --seeds=1-5 [--time=60] [--jobs=4] [--out=benchmark]
+//
+// or time of evaluation by number of rooms, see Scaling
+// usage: batch --scaling=10,20,50,100,200,500,1000,2000 [--seeds=1] [--evaluations=100]
+//
+// or a check that runs resumed from checkpoints go on as whole runs, see Resume
+// usage: batch --resume=eo.param,hybrid.param,moeo.param,tabu.param [--seeds=1] [--problems=problem.json] [--generations=10] [--jobs=4] [--out=resume]
+
+
+// Runs
+
+struct Run {
+    Run()
+        : seed(0), size(0), best(0), candidate(0)
+    {}
+
+    QString param, problem, dir, command;
+    int seed, size; // genome size of problem
+
+    vector<double> genome; // best of last generation
+    double best;
+    int candidate; // of tuning
+    QList<int> generations; // of generation files, with their best
+    QList<double> bests;
+};
+
+// stat rows per generation file, best row of last one with its plan
+const char resultsHeader[] = "param\tproblem\tseed\tkind\tgeneration\tbest\tmean\tgenome\n";
+
+bool loadProblem(QString problem, House& house);
+
+class Batch {
+public:
+    QList<Run> runs;
+    QFile results;
+    bool pin;
+    int timeout; // seconds of wall clock of a run, 0 for none
+    bool evaluate; // values of individuals by their plans, for engines of any fitness
+
+    Batch()
+        : pin(QFile::exists("/usr/bin/taskset")), timeout(0), evaluate(false), next(0)
+    {}
+
+    Run* take()
+    {
+        QMutexLocker locker(&mutex);
+        return next < runs.size() ? &runs[next++] : 0;
+    }
+
+    void clear()
+    {
+        runs.clear();
+        next = 0;
+    }
+
+    // write per generation statistics and best plan of a finished run
+    void collect(Run& run)
+    {
+        QStringList files = generationFiles(QDir(run.dir));
+
+        QString prefix = QString("%1\t%2\t%3").arg(QFileInfo(run.param).baseName()).arg(QFileInfo(run.problem).baseName()).arg(run.seed);
+        QStringList rows;
+
+        House house;
+        if (evaluate)
+            loadProblem(run.problem, house);
+
+        QStringList population;
+        for (int i = 0; i < files.size(); i++)
+        {
+            if (! readGeneration(files[i], population) || population.size() == 0)
+                continue;
+
+            double value, best = 0, sum = 0; int fittest = 0;
+            for (int j = 0; j < population.size(); j++)
+            {
+                vector<double> genome;
+                if (evaluate)
+                    genome = getGenome(population[j], run.size);
+                if (int(genome.size()) == run.size)
+                    value = real_value(&house, genome);
+                else
+                    value = population[j].split(" ")[0].toDouble();
+                sum += value;
+                if (j == 0 || value < best)
+                    { best = value; fittest = j; }
+            }
+
+            rows << QString("%1\tstat\t%2\t%3\t%4\t").arg(prefix).arg(generationNumber(files[i])).arg(best).arg(sum / population.size());
+            run.generations << generationNumber(files[i]);
+            run.bests << best;
+
+            if (i == files.size() - 1)
+            {
+                run.best = best;
+                run.genome = getGenome(population[fittest], run.size);
+            }
+        }
+
+        if (run.genome.size() > 0)
+        {
+            QString genome = QString("%1").arg(run.genome.size());
+            for (size_t i = 0; i < run.genome.size(); i++)
+                genome += QString(" %1").arg(run.genome[i]);
+            rows << QString("%1\tbest\t%2\t%3\t\t%4").arg(prefix).arg(run.generations.last()).arg(run.best).arg(genome);
+        }
+
+        QMutexLocker locker(&mutex);
+        QTextStream out(&results);
+        for (int i = 0; i < rows.size(); i++)
+            out << rows[i] << "\n";
+        out.flush();
+
+        cout << "finished " << qPrintable(run.dir) << endl;
+    }
+
+    // runs on jobs workers, each pinned to a core if possible
+    void execute(int jobs);
+
+private:
+    QMutex mutex;
+    int next;
+};
+
+class Worker : public QThread
+{
+public:
+    Batch* batch;
+    int core;
+
+    Worker(Batch* _batch, int _core)
+        : batch(_batch), core(_core)
+    {}
+
+    void run()
+    {
+        Run* run;
+        while ((run = batch->take()))
+        {
+            QString command = run->command;
+            if (batch->pin)
+                command = QString("taskset -c %1 ").arg(core) + command;
+
+            QProcess process;
+            process.setStandardOutputFile(run->dir + "/output.txt");
+            process.setStandardErrorFile(run->dir + "/error.txt");
+            process.start(command);
+            if (! process.waitForFinished(batch->timeout > 0 ? 1000 * batch->timeout : -1))
+            {
+                // out of wall clock, generation files so far count
+                process.terminate();
+                if (! process.waitForFinished(5000))
+                {
+                    process.kill();
+                    process.waitForFinished(-1);
+                }
+            }
+
+            batch->collect(*run);
+        }
+    }
+};
+
+void Batch::execute(int jobs)
+{
+    QList<Worker*> workers;
+    for (int i = 0; i < jobs; i++)
+    {
+        workers << new Worker(this, i % QThread::idealThreadCount());
+        workers.last()->start();
+    }
+    for (int i = 0; i < workers.size(); i++)
+    {
+        workers[i]->wait();
+        delete workers[i];
+    }
+}
+
+// engine command of a .param file with its result directory and seed, extra
+// parameters replace those of file
+QString makeCommand(QString param, QString problem, QString dir, int seed, QStringList extra = QStringList())
+{
+    QFile file(param);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return "";
+
+    QStringList lines = QString(file.readAll()).split("\n", QString::SkipEmptyParts), args;
+    for (int i = 0; i < lines.size(); i++)
+    {
+        QString line = lines[i].trimmed();
+        bool replaced = false;
+        for (int j = 0; j < extra.size(); j++)
+            if (line.startsWith(extra[j].section("=", 0, 0) + "="))
+                replaced = true;
+        if (! (replaced || line.startsWith("--resDir") || line.startsWith("--eraseDir") || line.startsWith("--seed") || line.startsWith("--problem")))
+            args << line;
+    }
+
+    args << "--resDir=" + dir << "--eraseDir=1" << QString("--seed=%1").arg(seed);
+    if (! problem.isEmpty())
+        args << "--problem=" + QFileInfo(problem).absoluteFilePath();
+    args << extra;
+
+    return args.join(" ");
+}
+
+// "1-3,7" as 1, 2, 3, 7
+QList<int> parseNumbers(QString value)
+{
+    QList<int> numbers;
+    QStringList parts = value.split(",", QString::SkipEmptyParts);
+    for (int i = 0; i < parts.size(); i++)
+    {
+        QStringList range = parts[i].split("-");
+        int first = range[0].toInt(), last = range.size() > 1 ? range[1].toInt() : first;
+        for (int number = first; number <= last; number++)
+            numbers << number;
+    }
+    return numbers;
+}
+
+// problem of run, built-in house without problem file
+bool loadProblem(QString problem, House& house)
+{
+    house = House();
+    return problem.isEmpty() || house.load(QFileInfo(problem).absoluteFilePath().toLocal8Bit().data());
+}
+
+void saveImage(const Run& run, QString filename)
+{
+    House* house = House::house;
+    loadProblem(run.problem, *house);
+
+    QStringList names;
+    for (size_t i = 0; i < house->rooms; i++)
+        names << QString::fromStdString(house->room[i].name);
+    PlanViewer::setProblem(names, house->original_width, house->original_height, house->wall, house->out_wall);
+
+    house->update(run.genome);
+    house->updateSpaces();
+
+    PlanViewer viewer(0, false);
+    viewer.setGenome(run.genome);
+    for (size_t i = 0; i < house->spaces.size(); i++)
+        viewer.spaces.push_back(QRectF(house->spaces[i].x1, house->spaces[i].y1, house->spaces[i].x2 - house->spaces[i].x1, house->spaces[i].y2 - house->spaces[i].y1));
+
+    QSize size(800, 600);
+    double r = min(size.width() / house->original_width, size.height() / house->original_height);
+    size.setWidth(round(r * house->original_width));
+    size.setHeight(round(r * house->original_height));
+
+    QImage img(size, QImage::Format_RGB32);
+    viewer.paintOn(&img, false, size);
+    img.save(filename, "png");
+}
+
+// Tuning
+
+// F-race (Birattari et al. 2002): candidate configurations of a .param file
+// run on instances, pairs of problem and seed, in turn. Once minInstances
+// are done, a Friedman test over ranks of candidates on each instance drops
+// candidates worse than best by Conover's post-hoc test. Target of a problem
+// is its best known value and a gap above it, or --target if it has none.
+// Cost of a run is its time to reach target, or ten times the cutoff, wall
+// clock time of a run by --time, if it did not or left no plan (PAR10); runs
+// stop at target by --targetFitness of EO. Candidates run as many instances at once
+// as keep all workers busy, within budget.
+//
+// Space file has a parameter per line: name and a list of values, a,b,c, or
+// a range, low:high, integer if both ends are. Candidate 0 is .param itself.
+
+const int minInstances = 5;
+
+bool bestKnown(QString problem, double& value);
+
+struct Parameter {
+    QString name;
+    QStringList values;
+    double low, high;
+    bool range, integer;
+};
+
+struct Candidate {
+    QString param;
+    QStringList values; // of parameters
+    QList<double> costs; // per instance
+    bool alive;
+};
+
+bool readSpace(QString filename, QList<Parameter>& space)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QStringList lines = QString(file.readAll()).split("\n", QString::SkipEmptyParts);
+    for (int i = 0; i < lines.size(); i++)
+    {
+        QStringList parts = lines[i].trimmed().split(QRegExp("\\s+"), QString::SkipEmptyParts);
+        if (parts.size() < 2 || parts[0].startsWith("#"))
+            continue;
+
+        Parameter parameter;
+        parameter.name = parts[0];
+        parameter.range = parts[1].contains(":");
+        if (parameter.range)
+        {
+            QStringList ends = parts[1].split(":");
+            parameter.low = ends[0].toDouble();
+            parameter.high = ends[1].toDouble();
+            parameter.integer = ! ends[0].contains(".") && ! ends[1].contains(".");
+        }
+        else
+            parameter.values = parts[1].split(",", QString::SkipEmptyParts);
+        space << parameter;
+    }
+    return space.size() > 0;
+}
+
+QString sampleValue(const Parameter& parameter)
+{
+    double u = qrand() / (RAND_MAX + 1.0);
+    if (! parameter.range)
+        return parameter.values[int(u * parameter.values.size())];
+    if (parameter.integer)
+        return QString::number(qRound(parameter.low + u * (parameter.high - parameter.low)));
+    return QString::number(parameter.low + u * (parameter.high - parameter.low), 'g', 4);
+}
+
+// .param file with values of parameters replaced or added
+bool writeParam(QString base, QString filename, const QList<Parameter>& space, const QStringList& values)
+{
+    QFile in(base), out(filename);
+    if (!in.open(QIODevice::ReadOnly | QIODevice::Text) || !out.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+
+    QStringList lines = QString(in.readAll()).split("\n");
+    QList<bool> written;
+    for (int j = 0; j < space.size(); j++)
+        written << false;
+
+    for (int i = 0; i < lines.size(); i++)
+        for (int j = 0; j < space.size(); j++)
+            if (lines[i].trimmed().startsWith("--" + space[j].name + "="))
+            {
+                lines[i] = QString("--%1=%2").arg(space[j].name).arg(values[j]);
+                written[j] = true;
+            }
+
+    for (int j = 0; j < space.size(); j++)
+        if (! written[j])
+            lines.insert(lines.size() - 1, QString("--%1=%2").arg(space[j].name).arg(values[j]));
+
+    QTextStream(&out) << lines.join("\n");
+    return true;
+}
+
+// value of a parameter in a .param file
+QString paramValue(QString filename, QString name)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return "";
+
+    QStringList lines = QString(file.readAll()).split("\n", QString::SkipEmptyParts);
+    for (int i = 0; i < lines.size(); i++)
+        if (lines[i].trimmed().startsWith("--" + name + "="))
+            return lines[i].trimmed().section("=", 1);
+    return "";
+}
+
+// seconds of run at end of each generation, of telemetry rows
+QMap<int, double> generationTimes(QString dir)
+{
+    QMap<int, double> times;
+    QFile file(dir + "/telemetry.csv");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return times;
+
+    QStringList lines = QString(file.readAll()).split("\n", QString::SkipEmptyParts);
+    for (int i = 1; i < lines.size(); i++)
+    {
+        QStringList values = lines[i].split(",");
+        if (values.size() > 1)
+            times[values[0].toInt()] = values[1].toDouble();
+    }
+    return times;
+}
+
+double runTime(QString dir)
+{
+    QMap<int, double> times = generationTimes(dir);
+    return times.size() ? times.values().last() : 0;
+}
+
+double normalQuantile(double p)
+{
+    double q = p < 0.5 ? p : 1 - p, t = sqrt(-2 * log(q));
+    double z = t - (2.515517 + 0.802853*t + 0.010328*t*t) / (1 + 1.432788*t + 0.189269*t*t + 0.001308*t*t*t);
+    return p < 0.5 ? -z : z;
+}
+
+// Wilson-Hilferty
+double chiSquareQuantile(double p, double df)
+{
+    double z = normalQuantile(p), a = 2 / (9 * df);
+    return df * pow(1 - a + z * sqrt(a), 3);
+}
+
+// Cornish-Fisher expansion
+double studentQuantile(double p, double df)
+{
+    double z = normalQuantile(p), z3 = z*z*z, z5 = z3*z*z;
+    return z + (z3 + z) / (4 * df) + (5*z5 + 16*z3 + 3*z) / (96 * df * df);
+}
+
+// ranks of costs, 1 for least, ties share their mean rank
+QList<double> ranks(const QList<double>& costs)
+{
+    QList<double> result;
+    for (int i = 0; i < costs.size(); i++)
+    {
+        int less = 0, equal = 0;
+        for (int j = 0; j < costs.size(); j++)
+            if (costs[j] < costs[i]) less++;
+            else if (costs[j] == costs[i]) equal++;
+        result << less + (equal + 1) / 2.0;
+    }
+    return result;
+}
+
+// rank sums of alive candidates over instances, and sum of squared ranks
+QList<double> rankSums(const QList<Candidate>& candidates, const QList<int>& alive, int instances, double& squares)
+{
+    QList<double> sums;
+    for (int j = 0; j < alive.size(); j++)
+        sums << 0;
+
+    squares = 0;
+    for (int i = 0; i < instances; i++)
+    {
+        QList<double> costs;
+        for (int j = 0; j < alive.size(); j++)
+            costs << candidates[alive[j]].costs[i];
+
+        QList<double> r = ranks(costs);
+        for (int j = 0; j < alive.size(); j++)
+        {
+            sums[j] += r[j];
+            squares += r[j] * r[j];
+        }
+    }
+    return sums;
+}
+
+QList<int> aliveCandidates(const QList<Candidate>& candidates)
+{
+    QList<int> alive;
+    for (int c = 0; c < candidates.size(); c++)
+        if (candidates[c].alive)
+            alive << c;
+    return alive;
+}
+
+// drops candidates worse than best, if Friedman test finds a difference
+void friedmanRace(QList<Candidate>& candidates, int instances, double alpha)
+{
+    QList<int> alive = aliveCandidates(candidates);
+    int k = alive.size(), m = instances;
+    if (k < 2 || m < minInstances)
+        return;
+
+    double squares;
+    QList<double> sums = rankSums(candidates, alive, m, squares);
+
+    double spread = 0, sumSquares = 0, best = sums[0];
+    for (int j = 0; j < k; j++)
+    {
+        spread += (sums[j] - m * (k + 1) / 2.0) * (sums[j] - m * (k + 1) / 2.0);
+        sumSquares += sums[j] * sums[j];
+        best = min(best, sums[j]);
+    }
+
+    double denominator = squares - m * k * (k + 1) * (k + 1) / 4.0;
+    if (denominator <= 0)
+        return; // all ranks equal
+
+    double statistic = (m - 1) * spread / denominator;
+    if (statistic <= chiSquareQuantile(1 - alpha, k - 1))
+        return;
+
+    double df = (m - 1) * (k - 1);
+    double difference = studentQuantile(1 - alpha / 2, df) * sqrt(2 * (m * squares - sumSquares) / df);
+    for (int j = 0; j < k; j++)
+        if (sums[j] - best > difference)
+            candidates[alive[j]].alive = false;
+}
+
+int problemSize(QString problem)
+{
+    House house;
+    return loadProblem(problem, house) ? 4 * house.rooms : -1;
+}
+
+int tune(QString base, QString spaceFile, double gap, QString target, QStringList problems, QList<int> seeds, int count, int budget, int cutoff, double alpha, int jobs, QString out)
+{
+    QList<Parameter> space;
+    if (! readSpace(spaceFile, space))
+    {
+        cout << "could not read space " << qPrintable(spaceFile) << endl;
+        return 1;
+    }
+
+    QList<int> sizes;
+    QList<double> targets;
+    for (int q = 0; q < problems.size(); q++)
+    {
+        sizes << problemSize(problems[q]);
+        if (sizes.last() < 0)
+        {
+            cout << "could not read problem " << qPrintable(problems[q]) << endl;
+            return 1;
+        }
+
+        double known;
+        if (bestKnown(problems[q], known))
+            targets << known + gap * max(fabs(known), 1.0);
+        else if (! target.isEmpty())
+            targets << target.toDouble();
+        else
+        {
+            cout << "no best known value of " << qPrintable(problems[q].isEmpty() ? "house" : problems[q]) << ", give --target" << endl;
+            return 1;
+        }
+    }
+
+    // instances, seeds of each problem in turn
+    QList< QPair<int, int> > instances;
+    for (int s = 0; s < seeds.size(); s++)
+        for (int q = 0; q < problems.size(); q++)
+            instances << qMakePair(q, seeds[s]);
+
+    QString outDir = QFileInfo(out).absoluteFilePath();
+    QDir().mkpath(outDir + "/candidates");
+
+    qsrand(1);
+    QList<Candidate> candidates;
+    for (int c = 0; c < count; c++)
+    {
+        Candidate candidate;
+        for (int j = 0; j < space.size(); j++)
+        {
+            QString value = c == 0 ? paramValue(base, space[j].name) : "";
+            candidate.values << (value.isEmpty() ? sampleValue(space[j]) : value);
+        }
+        candidate.param = QString("%1/candidates/c%2.param").arg(outDir).arg(c);
+        candidate.alive = writeParam(base, candidate.param, space, candidate.values);
+        candidates << candidate;
+    }
+
+    Batch batch;
+    batch.timeout = cutoff;
+    batch.results.setFileName(out + "/results.txt");
+    if (! batch.results.open(QIODevice::WriteOnly | QIODevice::Text))
+        return 1;
+    QTextStream(&batch.results) << resultsHeader;
+
+    int done = 0, spent = 0;
+    while (done < instances.size())
+    {
+        int alive = aliveCandidates(candidates).size();
+        if (alive <= 1 || spent + alive > budget)
+            break;
+
+        // instances of this step
+        int step = max(1, min(jobs / alive, (budget - spent) / alive));
+        step = min(step, instances.size() - done);
+        if (done < minInstances)
+            step = min(max(step, minInstances - done), instances.size() - done);
+        step = min(step, (budget - spent) / alive);
+
+        batch.clear();
+        for (int i = done; i < done + step; i++)
+            for (int c = 0; c < candidates.size(); c++)
+                if (candidates[c].alive)
+                {
+                    int q = instances[i].first;
+                    Run run;
+                    run.param = candidates[c].param; run.problem = problems[q]; run.seed = instances[i].second; run.size = sizes[q];
+                    run.candidate = c;
+                    run.dir = QString("%1/c%2-%3-%4").arg(outDir).arg(c).arg(problems[q].isEmpty() ? "house" : QFileInfo(run.problem).baseName()).arg(run.seed);
+                    run.command = makeCommand(run.param, run.problem, run.dir, run.seed, QStringList() << QString("--targetFitness=%1").arg(targets[q], 0, 'g', 17));
+
+                    QDir().mkpath(run.dir);
+                    batch.runs << run;
+                }
+
+        cout << "instances " << done + 1 << "-" << done + step << ": " << batch.runs.size() << " runs of " << alive << " candidates" << endl;
+        batch.execute(jobs);
+
+        // costs in order of instances
+        for (int i = 0; i < batch.runs.size(); i++)
+        {
+            Run& run = batch.runs[i];
+            bool reached = run.genome.size() > 0 && run.best <= targets[problems.indexOf(run.problem)];
+            candidates[run.candidate].costs << (reached ? runTime(run.dir) : 10.0 * cutoff);
+        }
+
+        done += step;
+        spent += batch.runs.size();
+        friedmanRace(candidates, done, alpha);
+    }
+
+    // least rank sum of alive candidates
+    double squares;
+    QList<int> alive = aliveCandidates(candidates);
+    QList<double> sums = rankSums(candidates, alive, done, squares);
+    int best = -1;
+    for (int j = 0; j < alive.size(); j++)
+        if (best < 0 || sums[j] < sums[best])
+            best = j;
+    if (best >= 0)
+        best = alive[best];
+
+    QFile summary(out + "/race.txt");
+    if (summary.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        QTextStream stream(&summary);
+        stream << "candidate\talive\tinstances\tmeanCost";
+        for (int j = 0; j < space.size(); j++)
+            stream << "\t" << space[j].name;
+        stream << "\n";
+
+        for (int c = 0; c < candidates.size(); c++)
+        {
+            double sum = 0;
+            for (int i = 0; i < candidates[c].costs.size(); i++)
+                sum += candidates[c].costs[i];
+            stream << c << "\t" << candidates[c].alive << "\t" << candidates[c].costs.size() << "\t" << (candidates[c].costs.size() ? sum / candidates[c].costs.size() : 0);
+            for (int j = 0; j < space.size(); j++)
+                stream << "\t" << candidates[c].values[j];
+            stream << "\n";
+        }
+    }
+
+    if (best < 0 || ! writeParam(base, out + "/tuned.param", space, candidates[best].values))
+    {
+        cout << "no configuration" << endl;
+        return 1;
+    }
+
+    cout << "best candidate " << best << " after " << done << " instances and " << spent << " runs:";
+    for (int j = 0; j < space.size(); j++)
+        cout << " --" << qPrintable(space[j].name) << "=" << qPrintable(candidates[best].values[j]);
+    cout << endl << "written to " << qPrintable(out + "/tuned.param") << endl;
+    return 0;
+}
+
+// Benchmark
+
+// Instances of instances.h are written as files of a directory, with the
+// best known value of each once a benchmark beats it. Engines run every
+// instance and seed for a wall clock time, saving every generation, and
+// values of plans are evaluated here, so engines of other fitness (moeo)
+// compare. Targets of an instance are best known value and gaps above it;
+// time to target of a run is telemetry time of first generation reaching
+// it. An ECDF of times to target per engine and target, over its runs, and
+// a scoreboard of solved runs and median times are written. Engines of a
+// fixed vecSize (es) optimize built-in house only, so they are skipped.
+
+const double targetGaps[] = {0, 0.01, 0.05, 0.1};
+const int targetGapCount = sizeof(targetGaps) / sizeof(targetGaps[0]);
+
+QRegExp bestKnownPattern("\"best known\":\\s*([-+0-9.eE]+)");
+
+// best known value of instance file, false if it has none
+bool bestKnown(QString problem, double& value)
+{
+    QFile file(problem);
+    if (! file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QRegExp pattern = bestKnownPattern;
+    if (pattern.indexIn(QString(file.readAll())) < 0)
+        return false;
+    value = pattern.cap(1).toDouble();
+    return true;
+}
+
+bool writeBestKnown(QString problem, double value)
+{
+    QFile file(problem);
+    if (! file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QString text = file.readAll();
+    file.close();
+
+    QString entry = QString("\"best known\": %1").arg(value, 0, 'g', 17);
+    QRegExp pattern = bestKnownPattern;
+    if (pattern.indexIn(text) >= 0)
+        text.replace(pattern.pos(0), pattern.matchedLength(), entry);
+    else
+        text.replace(text.indexOf("{\n"), 2, "{\n    " + entry + ",\n");
+
+    if (! file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream(&file) << text;
+    return true;
+}
+
+int generate(QString dir, QList<int> rooms, QList<int> seeds)
+{
+    QDir().mkpath(dir);
+    for (int r = 0; r < rooms.size(); r++)
+        for (int s = 0; s < seeds.size(); s++)
+        {
+            QString filename = QString("%1/%2.json").arg(dir).arg(QString::fromStdString(instanceName(seeds[s], rooms[r])));
+
+            double best;
+            string known = bestKnown(filename, best) ? QString::number(best, 'g', 17).toStdString() : "";
+
+            QFile file(filename);
+            if (! file.open(QIODevice::WriteOnly | QIODevice::Text))
+            {
+                cout << "could not write " << qPrintable(filename) << endl;
+                return 1;
+            }
+            QTextStream(&file) << QString::fromStdString(generateProblem(seeds[s], rooms[r], known));
+            cout << qPrintable(filename) << endl;
+        }
+    return 0;
+}
+
+// seconds to reach target of a run, negative if it did not
+double timeToTarget(const Run& run, const QMap<int, double>& times, double target)
+{
+    for (int i = 0; i < run.generations.size(); i++)
+        if (run.bests[i] <= target)
+        {
+            QMap<int, double>::const_iterator t = times.lowerBound(run.generations[i]);
+            if (t == times.end())
+                return times.size() ? times.values().last() : 0;
+            return t.value();
+        }
+    return -1;
+}
+
+int benchmark(QString dir, QStringList params, QList<int> seeds, int time, int jobs, QString out)
+{
+    QStringList problems;
+    QStringList files = QDir(dir).entryList(QStringList() << "*.json", QDir::Files, QDir::Name);
+    for (int i = 0; i < files.size(); i++)
+        problems << dir + "/" + files[i];
+    if (problems.size() == 0)
+    {
+        cout << "no instances in " << qPrintable(dir) << endl;
+        return 1;
+    }
+
+    QList<int> sizes;
+    for (int q = 0; q < problems.size(); q++)
+    {
+        sizes << problemSize(problems[q]);
+        if (sizes.last() < 0)
+        {
+            cout << "could not read problem " << qPrintable(problems[q]) << endl;
+            return 1;
+        }
+    }
+
+    QStringList engines;
+    for (int p = 0; p < params.size(); p++)
+        if (paramValue(params[p], "vecSize").isEmpty())
+            engines << params[p];
+        else
+            cout << "skipped " << qPrintable(params[p]) << ", its vecSize is fixed" << endl;
+
+    Batch batch;
+    batch.timeout = time;
+    batch.evaluate = true;
+    QString outDir = QFileInfo(out).absoluteFilePath();
+    QStringList extra = QStringList() << "--saveFrequency=1" << "--maxGen=100000";
+
+    for (int p = 0; p < engines.size(); p++)
+        for (int q = 0; q < problems.size(); q++)
+            for (int s = 0; s < seeds.size(); s++)
+            {
+                Run run;
+                run.param = engines[p]; run.problem = problems[q]; run.seed = seeds[s]; run.size = sizes[q];
+                run.candidate = p;
+                run.dir = QString("%1/%2-%3-%4").arg(outDir).arg(QFileInfo(run.param).baseName()).arg(QFileInfo(run.problem).baseName()).arg(run.seed);
+                run.command = makeCommand(run.param, run.problem, run.dir, run.seed, extra);
+
+                QDir().mkpath(run.dir);
+                if (! run.command.isEmpty())
+                    batch.runs << run;
+            }
+
+    batch.results.setFileName(out + "/results.txt");
+    if (! batch.results.open(QIODevice::WriteOnly | QIODevice::Text))
+        return 1;
+    QTextStream(&batch.results) << resultsHeader;
+
+    cout << batch.runs.size() << " runs of " << time << "s on " << jobs << " workers" << endl;
+    batch.execute(jobs);
+
+    // best known values
+    QList<double> bests;
+    for (int q = 0; q < problems.size(); q++)
+    {
+        double best, known = 0;
+        bool found = bestKnown(problems[q], known), beaten = false;
+        best = known;
+        for (int i = 0; i < batch.runs.size(); i++)
+        {
+            const Run& run = batch.runs[i];
+            if (run.problem == problems[q] && run.genome.size() > 0 && (! found || run.best < best))
+            {
+                best = run.best;
+                found = beaten = true;
+            }
+        }
+        if (beaten)
+        {
+            writeBestKnown(problems[q], best);
+            cout << "best known of " << qPrintable(QFileInfo(problems[q]).baseName()) << ": " << best << endl;
+        }
+        bests << (found ? best : 0);
+    }
+
+    // times to target by engine and target
+    QList< QList< QList<double> > > solved; // [engine][gap], seconds
+    QList<int> runs;
+    for (int p = 0; p < engines.size(); p++)
+    {
+        solved << QList< QList<double> >();
+        for (int g = 0; g < targetGapCount; g++)
+            solved[p] << QList<double>();
+        runs << 0;
+    }
+
+    for (int i = 0; i < batch.runs.size(); i++)
+    {
+        const Run& run = batch.runs[i];
+        double best = bests[problems.indexOf(run.problem)];
+        QMap<int, double> times = generationTimes(run.dir);
+
+        runs[run.candidate]++;
+        for (int g = 0; g < targetGapCount; g++)
+        {
+            double t = timeToTarget(run, times, best + targetGaps[g] * max(fabs(best), 1.0));
+            if (t >= 0)
+                solved[run.candidate][g] << t;
+        }
+    }
+
+    QFile ecdf(out + "/ecdf.txt"), scoreboard(out + "/scoreboard.txt");
+    if (! ecdf.open(QIODevice::WriteOnly | QIODevice::Text) || ! scoreboard.open(QIODevice::WriteOnly | QIODevice::Text))
+        return 1;
+    QTextStream ecdfStream(&ecdf), scoreStream(&scoreboard);
+    ecdfStream << "engine\tgap\ttime\tfraction\n";
+    scoreStream << "engine\tgap\tsolved\tmedianTime\n";
+
+    for (int p = 0; p < engines.size(); p++)
+        for (int g = 0; g < targetGapCount; g++)
+        {
+            QString engine = QFileInfo(engines[p]).baseName();
+            QList<double>& times = solved[p][g];
+            qSort(times);
+            for (int i = 0; i < times.size(); i++)
+                ecdfStream << engine << "\t" << targetGaps[g] << "\t" << times[i] << "\t" << double(i + 1) / runs[p] << "\n";
+
+            // median over all runs, of which those not reaching target are last
+            QString median = 2 * times.size() > runs[p] ? QString::number(times[(runs[p] - 1) / 2]) : "-";
+            QString row = QString("%1\t%2\t%3\t%4").arg(engine).arg(targetGaps[g]).arg(runs[p] ? double(times.size()) / runs[p] : 0).arg(median);
+            scoreStream << row << "\n";
+            cout << qPrintable(row) << endl;
+        }
+
+    return 0;
+}
+
+
+// Scaling
+
+// Time of evaluation of random plans of generated instances, by number of
+// rooms, with time of spaces (space detection and access graph) alone and
+// growth exponents of both from previous size, 1 for linear and 2 for
+// quadratic growth.
+
+int scaling(QList<int> rooms, QList<int> seeds, int evaluations)
+{
+    QString filename = QDir::temp().absoluteFilePath("scaling.json");
+    cout << "rooms\tevaluation\tspaces\tevaluationExponent\tspacesExponent" << endl;
+
+    double lastRooms = 0, lastTime = 0, lastSpaces = 0;
+    for (int r = 0; r < rooms.size(); r++)
+    {
+        Telemetry telemetry;
+        House house;
+        house.telemetry = &telemetry;
+
+        double time = 0;
+        for (int s = 0; s < seeds.size(); s++)
+        {
+            QFile file(filename);
+            if (! file.open(QIODevice::WriteOnly | QIODevice::Text))
+                return 1;
+            QTextStream(&file) << QString::fromStdString(generateProblem(seeds[s], rooms[r]));
+            file.close();
+            if (! loadProblem(filename, house))
+                return 1;
+            house.telemetry = &telemetry;
+
+            // rooms of about twice mean side, to overlap as plans of a run
+            PhiloxStream stream(seeds[s], rooms[r]);
+            RandomStream& random = stream;
+            double width = house.space.getWidth(), height = house.space.getHeight(), side = 2 * sqrt(width * height / house.rooms);
+            vector< vector<double> > plans(evaluations, vector<double>(house.rooms * 4));
+            for (int i = 0; i < evaluations; i++)
+                for (size_t j = 0; j < house.rooms; j++)
+                {
+                    plans[i][j*4] = random.uniform(width); plans[i][j*4+1] = random.uniform(height);
+                    plans[i][j*4+2] = random.uniform(side); plans[i][j*4+3] = random.uniform(side);
+                }
+
+            double start = Telemetry::now();
+            for (int i = 0; i < evaluations; i++)
+                real_value(&house, plans[i]);
+            time += Telemetry::now() - start;
+        }
+        QFile::remove(filename);
+
+        double count = double(evaluations) * seeds.size();
+        double evaluation = time / count, spaces = (telemetry.componentTime[Telemetry::Spaces] + telemetry.componentTime[Telemetry::Access]) / count;
+        QString row = QString("%1\t%2\t%3").arg(rooms[r]).arg(evaluation * 1e6).arg(spaces * 1e6);
+        if (lastRooms > 0)
+            row += QString("\t%1\t%2").arg(log(evaluation / lastTime) / log(rooms[r] / lastRooms), 0, 'f', 2).arg(log(spaces / lastSpaces) / log(rooms[r] / lastRooms), 0, 'f', 2);
+        cout << qPrintable(row) << endl;
+
+        lastRooms = rooms[r]; lastTime = evaluation; lastSpaces = spaces;
+    }
+
+    return 0;
+}
+
+
+// Resume
+
+// Each run is done whole for twice generations, and again to a checkpoint
+// at generations and resumed from it in same directory. Populations of
+// resumed generations are compared with those of whole run.
+
+int resume(QStringList params, QStringList problems, QList<int> seeds, int generations, int jobs, QString out)
+{
+    Batch batch;
+    QString outDir = QFileInfo(out).absoluteFilePath();
+    QStringList whole = QStringList() << "--saveFrequency=1" << "--asyncSave=1" << "--checkpointInterval=0" << QString("--maxGen=%1").arg(2 * generations),
+                half = QStringList() << "--saveFrequency=1" << "--asyncSave=1" << "--checkpointInterval=0" << QString("--maxGen=%1").arg(generations) << QString("--checkpointGeneration=%1").arg(generations);
+
+    QList<Run> resumed;
+    for (int p = 0; p < params.size(); p++)
+        for (int q = 0; q < problems.size(); q++)
+            for (int s = 0; s < seeds.size(); s++)
+            {
+                Run run;
+                run.param = params[p]; run.problem = problems[q]; run.seed = seeds[s]; run.size = problemSize(problems[q]);
+                QString name = QString("%1/%2-%3-%4").arg(outDir).arg(QFileInfo(run.param).baseName()).arg(problems[q].isEmpty() ? "house" : QFileInfo(run.problem).baseName()).arg(run.seed);
+
+                run.dir = name + "-whole";
+                run.command = makeCommand(run.param, run.problem, run.dir, run.seed, whole);
+                QDir().mkpath(run.dir);
+                if (run.command.isEmpty())
+                    continue;
+                batch.runs << run;
+
+                run.dir = name + "-resumed";
+                run.command = makeCommand(run.param, run.problem, run.dir, run.seed, half);
+                QDir().mkpath(run.dir);
+                batch.runs << run;
+
+                QStringList rest = QStringList() << "--saveFrequency=1" << "--asyncSave=1" << "--checkpointInterval=0" << QString("--maxGen=%1").arg(2 * generations) << "--resume=" + run.dir + "/checkpoint.state";
+                run.command = makeCommand(run.param, run.problem, run.dir, run.seed, rest);
+                resumed << run;
+            }
+
+    batch.results.setFileName(out + "/results.txt");
+    if (! batch.results.open(QIODevice::WriteOnly | QIODevice::Text))
+        return 1;
+    QTextStream(&batch.results) << resultsHeader;
+
+    cout << batch.runs.size() << " runs on " << jobs << " workers" << endl;
+    batch.execute(jobs);
+    batch.clear();
+    batch.runs = resumed;
+    cout << batch.runs.size() << " resumed runs" << endl;
+    batch.execute(jobs);
+
+    int differing = 0;
+    for (int i = 0; i < resumed.size(); i++)
+    {
+        QString dir = resumed[i].dir, name = dir.left(dir.size() - QString("-resumed").size());
+        QStringList wholeFiles = generationFiles(QDir(name + "-whole")), resumedFiles = generationFiles(QDir(dir));
+
+        QMap<int, QString> files;
+        for (int j = 0; j < resumedFiles.size(); j++)
+            files[generationNumber(resumedFiles[j])] = resumedFiles[j];
+
+        // first generation of whole run a resumed run misses or differs in
+        int compared = 0, differs = -1;
+        for (int j = 0; j < wholeFiles.size() && differs < 0; j++)
+        {
+            int generation = generationNumber(wholeFiles[j]);
+            if (generation <= generations)
+                continue;
+
+            QStringList wholePopulation, resumedPopulation;
+            if (! files.contains(generation) || ! readGeneration(wholeFiles[j], wholePopulation) || ! readGeneration(files[generation], resumedPopulation) || wholePopulation != resumedPopulation)
+                differs = generation;
+            else
+                compared++;
+        }
+
+        if (differs >= 0 || ! compared)
+            differing++;
+        if (differs >= 0)
+            cout << qPrintable(QFileInfo(name).fileName()) << "\tdiffers at generation " << differs << endl;
+        else
+            cout << qPrintable(QFileInfo(name).fileName()) << "\t" << (compared ? QString("same in %1 generations").arg(compared) : QString("no resumed generations")).toStdString() << endl;
+    }
+
+    return differing ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    // widgets only to render images, so runs need no display
+    bool images = false;
+    for (int i = 1; i < argc; i++)
+        if (QString(argv[i]) == "--images")
+            images = true;
+    QScopedPointer<QCoreApplication> a(images ? new QApplication(argc, argv) : new QCoreApplication(argc, argv));
+
+    QStringList params, problems;
+    QList<int> seeds, rooms;
+    QString out = "batch", tuned, space, target, generated, benchmarked;
+    QList<int> scaled;
+    QStringList resumed;
+    int jobs = QThread::idealThreadCount(), candidates = 20, budget = 0, time = 60, evaluations = 100, generations = 10;
+    double alpha = 0.05, gap = 0.05;
+
+    QStringList args = a->arguments();
+    for (int i = 1; i < args.size(); i++)
+    {
+        QString arg = args[i], value = arg.section("=", 1);
+        if (arg.startsWith("--params=")) params = value.split(",", QString::SkipEmptyParts);
+        else if (arg.startsWith("--problems=")) problems = value.split(",", QString::SkipEmptyParts);
+        else if (arg.startsWith("--seeds=")) seeds = parseNumbers(value);
+        else if (arg.startsWith("--jobs=")) jobs = value.toInt();
+        else if (arg.startsWith("--out=")) out = value;
+        else if (arg.startsWith("--tune=")) tuned = value;
+        else if (arg.startsWith("--space=")) space = value;
+        else if (arg.startsWith("--target=")) target = value;
+        else if (arg.startsWith("--candidates=")) candidates = value.toInt();
+        else if (arg.startsWith("--budget=")) budget = value.toInt();
+        else if (arg.startsWith("--alpha=")) alpha = value.toDouble();
+        else if (arg.startsWith("--gap=")) gap = value.toDouble();
+        else if (arg.startsWith("--generate=")) generated = value;
+        else if (arg.startsWith("--rooms=")) rooms = parseNumbers(value);
+        else if (arg.startsWith("--benchmark=")) benchmarked = value;
+        else if (arg.startsWith("--time=")) time = value.toInt();
+        else if (arg.startsWith("--scaling=")) scaled = parseNumbers(value);
+        else if (arg.startsWith("--evaluations=")) evaluations = value.toInt();
+        else if (arg.startsWith("--resume=")) resumed = value.split(",", QString::SkipEmptyParts);
+        else if (arg.startsWith("--generations=")) generations = value.toInt();
+    }
+
+    if (resumed.size() > 0)
+    {
+        if (generations <= 0)
+        {
+            cout << "usage: batch --resume=eo.param,hybrid.param,moeo.param,tabu.param [--seeds=1] [--problems=problem.json] [--generations=10] [--jobs=4] [--out=resume]" << endl;
+            return 1;
+        }
+        if (problems.size() == 0)
+            problems << "";
+        return resume(resumed, problems, seeds.size() ? seeds : QList<int>() << 1, generations, jobs, out == "batch" ? "resume" : out);
+    }
+
+    if (scaled.size() > 0)
+    {
+        if (evaluations <= 0)
+        {
+            cout << "usage: batch --scaling=10,20,50,100,200,500,1000,2000 [--seeds=1] [--evaluations=100]" << endl;
+            return 1;
+        }
+        return scaling(scaled, seeds.size() ? seeds : QList<int>() << 1, evaluations);
+    }
+
+    if (! generated.isEmpty())
+    {
+        if (rooms.size() == 0)
+        {
+            cout << "usage: batch --generate=instances --rooms=5,10,20,50,100,200 [--seeds=1]" << endl;
+            return 1;
+        }
+        return generate(generated, rooms, seeds.size() ? seeds : QList<int>() << 1);
+    }
+
+    if (! benchmarked.isEmpty())
+    {
+        if (params.size() == 0 || seeds.size() == 0 || time <= 0)
+        {
+            cout << "usage: batch --benchmark=instances --params=eo.param,es.param,hybrid.param,moeo.param --seeds=1-5 [--time=60] [--jobs=4] [--out=benchmark]" << endl;
+            return 1;
+        }
+        return benchmark(benchmarked, params, seeds, time, jobs, out == "batch" ? "benchmark" : out);
+    }
+
+    if (! tuned.isEmpty())
+    {
+        if (space.isEmpty() || seeds.size() == 0 || candidates < 2 || time <= 0)
+        {
+            cout << "usage: batch --tune=hybrid.param --space=hybrid.space --seeds=1-20 [--problems=instances/r010-s1.json] [--gap=0.05] [--target=-150] [--time=60] [--candidates=20] [--budget=400] [--alpha=0.05] [--jobs=4] [--out=tune]" << endl;
+            return 1;
+        }
+
+        if (problems.size() == 0)
+            problems << "";
+        if (budget <= 0)
+            budget = candidates * seeds.size() * problems.size();
+        return tune(tuned, space, gap, target, problems, seeds, candidates, budget, time, alpha, jobs, out == "batch" ? "tune" : out);
+    }
+
+    if (params.size() == 0 || seeds.size() == 0)
+    {
+        cout << "usage: batch --params=eo.param,hybrid.param --seeds=1-10 [--problems=problem.json] [--jobs=4] [--out=batch] [--images]" << endl;
+        return 1;
+    }
+
+    if (problems.size() == 0)
+        problems << "";
+
+    Batch batch;
+    QList<int> sizes;
+    if (images)
+        QDir().mkpath(out + "/images");
+    QString outDir = QFileInfo(out).absoluteFilePath();
+
+    for (int q = 0; q < problems.size(); q++)
+    {
+        sizes << problemSize(problems[q]);
+        if (sizes.last() < 0)
+        {
+            cout << "could not read problem " << qPrintable(problems[q]) << endl;
+            return 1;
+        }
+    }
+
+    for (int p = 0; p < params.size(); p++)
+        for (int q = 0; q < problems.size(); q++)
+            for (int s = 0; s < seeds.size(); s++)
+            {
+                Run run;
+                run.param = params[p]; run.problem = problems[q]; run.seed = seeds[s]; run.size = sizes[q];
+                run.dir = QString("%1/%2-%3-%4").arg(outDir).arg(QFileInfo(run.param).baseName()).arg(problems[q].isEmpty() ? "house" : QFileInfo(run.problem).baseName()).arg(run.seed);
+                run.command = makeCommand(run.param, run.problem, run.dir, run.seed);
+
+                QDir().mkpath(run.dir);
+                if (! run.command.isEmpty())
+                    batch.runs << run;
+            }
+
+    batch.results.setFileName(out + "/results.txt");
+    if (! batch.results.open(QIODevice::WriteOnly | QIODevice::Text))
+        return 1;
+    QTextStream(&batch.results) << resultsHeader;
+
+    cout << batch.runs.size() << " runs on " << jobs << " workers" << endl;
+    batch.execute(jobs);
+
+    // images of best plans
+    for (int i = 0; i < batch.runs.size() && images; i++)
+        if (batch.runs[i].genome.size() > 0)
+            saveImage(batch.runs[i], out + "/images/" + QFileInfo(batch.runs[i].dir).fileName() + ".png");
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Headless batch runner of engines
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = batch
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+
+SOURCES += batch.cpp \
+    planviewer.cpp
+
+HEADERS  += planviewer.h \
+    evaluate.h \
+    telemetry.h \
+    json.h \
+    genome.h \
+    trace.h \
+    compress.h \
+    generations.h \
+    instances.h \
+    random.h
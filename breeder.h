@@ -0,0 +1,459 @@
+
+#ifndef BREEDER_H
+#define BREEDER_H
+
+// needs eo, evaluate.h and operators.h to be included before
+
+#include <stdexcept>
+
+#include "checkpoint.h"
+#include "adaptive.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+inline int threadIndex()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+inline int threadCount()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+
+// evaluation on a given house, so each thread evaluates on its own
+// returns false if individual was already evaluated
+template <class EOT>
+class hadHouseEval
+{
+public:
+    virtual ~hadHouseEval()
+    {}
+
+    virtual bool operator()(EOT& g, House* house) = 0;
+};
+
+// real_value of plan, or of its repair by mode
+template <class EOT>
+class hadScalarEval : public eoEvalFunc<EOT>, public hadHouseEval<EOT>
+{
+public:
+    hadScalarEval(RepairMode _mode = NoRepair)
+        : mode(_mode)
+    {}
+
+    void operator()(EOT& g)
+    {
+        (*this)(g, House::house);
+    }
+
+    bool operator()(EOT& g, House* house)
+    {
+        if (! g.invalid())
+            return false;
+
+        if (mode == NoRepair)
+        {
+            g.fitness(real_value(house, g));
+            return true;
+        }
+
+        vector<double> genome = genomeMetres(g);
+        repairPlan(house, genome);
+
+        if (mode == Lamarckian)
+        {
+            setGenome(g, genome);
+            g.fitness(real_value(house, g));
+        }
+        else
+            g.fitness(real_value(house, genome));
+        return true;
+    }
+
+private:
+    RepairMode mode;
+};
+
+
+// same chain as do_make_op: clone or RoomExchangeCrossover, then one of
+// mutations by their rates, all drawing from the task's stream
+template <class EOT>
+class hadVariation
+{
+public:
+    double pCross, pMut;
+    RoomExchangeCrossover<EOT>* xover;
+    vector<StreamMonOp<EOT>*> mutations;
+    vector<double> rates;
+    hadOperatorSelector* selector; // adapts rates, 0 for fixed rates
+
+    hadVariation()
+        : pCross(0), pMut(0), xover(0), selector(0)
+    {}
+
+    void add(StreamMonOp<EOT>& mutation, double rate)
+    {
+        mutations.push_back(&mutation);
+        rates.push_back(rate);
+    }
+
+    // one pair of offspring
+    void operator()(EOT& g1, EOT& g2, RandomStream& random, House* house)
+    {
+        cross(g1, g2, random);
+        mutate(g1, random, house);
+        mutate(g2, random, house);
+    }
+
+    void cross(EOT& g1, EOT& g2, RandomStream& random)
+    {
+        if (xover && random.flip(pCross) && (*xover)(g1, g2, random))
+        {
+            g1.invalidate();
+            g2.invalidate();
+        }
+    }
+
+    // returns index of applied mutation, -1 for none
+    int mutate(EOT& g, RandomStream& random, House* house)
+    {
+        if (mutations.size() == 0 || ! random.flip(pMut))
+            return -1;
+
+        double sum = 0;
+        for (size_t i = 0; i < rates.size(); i++)
+            sum += rates[i];
+
+        // roulette wheel, like eoPropCombinedMonOp
+        double r = random.uniform(sum);
+        size_t i = 0;
+        for (; i < rates.size() - 1 && r >= rates[i]; i++)
+            r -= rates[i];
+
+        if ((*mutations[i])(g, random, house))
+            g.invalidate();
+        return i;
+    }
+};
+
+
+// Breeder
+
+// Parents are selected in order, then offspring pairs are varied and
+// evaluated as independent tasks on all threads. Task k of a generation
+// draws from stream (seed, generation, k), so offspring do not depend on
+// number of threads.
+template <class EOT>
+class hadParallelBreeder : public eoBreed<EOT>
+{
+public:
+    hadParallelBreeder(eoSelectOne<EOT>& _select, hadVariation<EOT>& _variation, hadHouseEval<EOT>& _eval, eoValueParam<unsigned long>& _counter, eoHowMany _howMany, uint32_t _seed)
+        : generation(0), select(_select), variation(_variation), eval(_eval), counter(_counter), howMany(_howMany), seed(_seed), telemetries(threadCount())
+    {
+        for (int i = 0; i < threadCount(); i++)
+        {
+            houses.push_back(new House(*House::house));
+            houses.back()->telemetry = 0;
+        }
+    }
+
+    ~hadParallelBreeder()
+    {
+        for (size_t i = 0; i < houses.size(); i++)
+            delete houses[i];
+    }
+
+    void operator()(const eoPop<EOT>& parents, eoPop<EOT>& offspring)
+    {
+        TRACE_ZONE("breed");
+
+        unsigned target = howMany(parents.size());
+        int pairs = (target + 1) / 2;
+
+        select.setup(parents);
+        offspring.resize(2 * pairs);
+        for (size_t i = 0; i < offspring.size(); i++)
+            offspring[i] = select(parents);
+
+        // fidelity of House::house, as of its schedule, and telemetry of
+        // each thread if House::house has one
+        for (size_t i = 0; i < houses.size(); i++)
+        {
+            houses[i]->webSize = House::house->webSize;
+            houses[i]->telemetry = House::house->telemetry ? &telemetries[i] : 0;
+        }
+
+        unsigned long evaluations = 0;
+        hadOperatorSelector* selector = variation.selector;
+        vector<int> applied(offspring.size(), -1);
+        vector<char> crossed(offspring.size(), 0);
+        vector<double> improvements(offspring.size(), 0), costs(offspring.size(), 0);
+        vector<double> crossImprovements(offspring.size(), 0), crossCosts(offspring.size(), 0);
+
+        #pragma omp parallel for schedule(dynamic) reduction(+:evaluations)
+        for (int k = 0; k < pairs; k++)
+        {
+            TRACE_ZONE("offspring");
+            House* house = houses[threadIndex()];
+            PhiloxStream random(seed, generation, k);
+
+            if (! selector)
+            {
+                variation(offspring[2*k], offspring[2*k+1], random, house);
+
+                if (eval(offspring[2*k], house)) evaluations++;
+                if (eval(offspring[2*k+1], house)) evaluations++;
+                continue;
+            }
+
+            // a crossed offspring is evaluated before its mutation, for
+            // credit of crossover over its parent and of mutation over it
+            EOT parents[2] = {offspring[2*k], offspring[2*k+1]};
+            variation.cross(offspring[2*k], offspring[2*k+1], random);
+            for (int i = 2*k; i < 2*k+2; i++)
+            {
+                double start = selector->clock(house);
+                if (eval(offspring[i], house))
+                {
+                    evaluations++;
+                    crossed[i] = true;
+                    crossCosts[i] = selector->clock(house) - start;
+                    crossImprovements[i] = operatorCredit(parents[i - 2*k], offspring[i]);
+                }
+
+                EOT original = offspring[i];
+                start = selector->clock(house);
+                applied[i] = variation.mutate(offspring[i], random, house);
+                if (eval(offspring[i], house)) evaluations++;
+                costs[i] = selector->clock(house) - start;
+                if (applied[i] >= 0)
+                    improvements[i] = operatorCredit(original, offspring[i]);
+            }
+        }
+
+        // in order of offspring, so rates do not depend on number of threads
+        if (selector)
+        {
+            for (int i = 0; i < 2 * pairs; i++)
+            {
+                if (crossed[i])
+                    selector->creditCrossover(crossImprovements[i], crossCosts[i]);
+                if (applied[i] >= 0)
+                    selector->credit(applied[i], improvements[i], costs[i]);
+            }
+            selector->update(generation);
+            variation.rates = selector->rates;
+        }
+
+        offspring.resize(target);
+        generation++;
+
+        counter.value() += evaluations;
+        if (House::house->telemetry)
+            for (size_t i = 0; i < houses.size(); i++)
+                House::house->telemetry->collect(telemetries[i]);
+    }
+
+    string className() const { return "hadParallelBreeder"; }
+
+    uint32_t generation; // of streams
+
+private:
+    eoSelectOne<EOT>& select;
+    hadVariation<EOT>& variation;
+    hadHouseEval<EOT>& eval;
+    eoValueParam<unsigned long>& counter;
+    eoHowMany howMany;
+    uint32_t seed;
+    vector<House*> houses;
+    vector<Telemetry> telemetries; // of houses
+};
+
+
+// adaptive rates of mutations of breeders, log next to generation files
+template <class EOT>
+hadOperatorSelector* do_make_operator_selector(eoParser& _parser, eoState& _state, hadVariation<EOT>& _variation, hadRunState& _runState)
+{
+    bool adaptive = _parser.createParam(false, "adaptiveOperators", "Adapt mutation rates to their progress", '\0', "Evolution Engine").value();
+    double minRate = _parser.createParam(0.05, "aosMinRate", "Minimum rate of each mutation with adaptive operators", '\0', "Evolution Engine").value();
+    double adaptation = _parser.createParam(0.3, "aosAdaptation", "Adaptation rate of mutation qualities", '\0', "Evolution Engine").value();
+    string cost = _parser.createParam(string("Evaluations"), "aosCost", "Cost of offspring: Evaluations or Time (thread CPU, not reproducible)", '\0', "Evolution Engine").value();
+    string resDir = _parser.getORcreateParam(string("Res"), "resDir", "Directory to store DISK outputs", '\0', "Output - Disk").value();
+
+    if (cost != "Evaluations" && cost != "Time")
+        throw runtime_error("Operator cost " + cost + " is not supported");
+    if (! adaptive || _variation.mutations.empty())
+        return 0;
+
+    vector<string> names;
+    for (size_t i = 0; i < _variation.mutations.size(); i++)
+        names.push_back(_variation.mutations[i]->className());
+
+    hadOperatorSelector* selector = new hadOperatorSelector(names, _variation.rates, minRate, adaptation, cost == "Time" ? hadOperatorSelector::Time : hadOperatorSelector::Evaluations);
+    _state.storeFunctor(selector);
+    _runState.add("operators", *selector);
+    selector->open((resDir + "/operators.csv").c_str(), _runState.resumed());
+
+    _variation.rates = selector->rates;
+    _variation.selector = selector;
+    return selector;
+}
+
+
+// Serial breeding
+
+// variation of serial breeding with adaptive rates, from the rng of EO: as
+// parallel breeder, a crossed offspring is evaluated before its mutation and
+// each offspring is evaluated as it is bred, for credits of its operators
+template <class EOT>
+class hadAdaptiveOp : public eoGenOp<EOT>
+{
+public:
+    hadAdaptiveOp(hadVariation<EOT>& _variation, eoEvalFunc<EOT>& _eval)
+        : variation(_variation), eval(_eval)
+    {}
+
+    unsigned max_production() { return 2; }
+
+    void apply(eoPopulator<EOT>& pop)
+    {
+        EOT& g1 = *pop;
+        EOT& g2 = *++pop;
+        EOT* offspring[2] = {&g1, &g2};
+        EOT parents[2] = {g1, g2};
+        hadOperatorSelector* selector = variation.selector;
+
+        variation.cross(g1, g2, globalStream);
+        for (int i = 0; i < 2; i++)
+        {
+            EOT& g = *offspring[i];
+            double start = selector->clock(House::house);
+            if (g.invalid())
+            {
+                eval(g);
+                selector->creditCrossover(operatorCredit(parents[i], g), selector->clock(House::house) - start);
+            }
+
+            EOT original = g;
+            start = selector->clock(House::house);
+            int applied = variation.mutate(g, globalStream, House::house);
+            if (g.invalid()) eval(g);
+            if (applied >= 0)
+                selector->credit(applied, operatorCredit(original, g), selector->clock(House::house) - start);
+        }
+    }
+
+    string className() const { return "hadAdaptiveOp"; }
+
+private:
+    hadVariation<EOT>& variation;
+    eoEvalFunc<EOT>& eval;
+};
+
+// rates of serial breeding at end of each generation
+template <class EOT>
+class hadOperatorUpdater : public eoUpdater
+{
+public:
+    hadOperatorUpdater(hadVariation<EOT>& _variation)
+        : generation(0), variation(_variation)
+    {}
+
+    void operator()()
+    {
+        variation.selector->update(generation++);
+        variation.rates = variation.selector->rates;
+    }
+
+    string className() const { return "hadOperatorUpdater"; }
+
+    unsigned long generation;
+
+private:
+    hadVariation<EOT>& variation;
+};
+
+// op of do_make_op for make_algo_scalar, or adaptive op of variation if
+// operators are adaptive
+template <class EOT>
+eoGenOp<EOT> & do_make_op_serial(eoParser& _parser, eoState& _state, eoEvalFunc<EOT>& _eval, eoCheckPoint<EOT>& _checkpoint, eoGenOp<EOT>& _op, hadVariation<EOT>& _variation, hadRunState& _runState)
+{
+    if (! do_make_operator_selector(_parser, _state, _variation, _runState))
+        return _op;
+
+    hadAdaptiveOp<EOT>* op = new hadAdaptiveOp<EOT>(_variation, _eval);
+    _state.storeFunctor(op);
+
+    hadOperatorUpdater<EOT>* updater = new hadOperatorUpdater<EOT>(_variation);
+    _state.storeFunctor(updater);
+    _runState.addValue("operatorGeneration", updater->generation);
+    _checkpoint.add(*updater);
+
+    return *op;
+}
+
+
+// eoEasyEA of make_algo_scalar with parallel breeder, for Sequential and
+// Random selections and Comma and Plus replacements
+template <class EOT>
+eoAlgo<EOT> & do_make_algo_parallel(eoParser& _parser, eoState& _state, eoEvalFuncCounter<EOT>& _eval, eoContinue<EOT>& _continue, hadVariation<EOT>& _variation, hadHouseEval<EOT>& _houseEval, hadRunState& _runState)
+{
+    eoParamParamType& ppSelect = _parser.getORcreateParam(eoParamParamType("Sequential"), "selection", "Selection: Sequential(ordered/unordered) or Random", '\0', "Evolution Engine").value();
+    eoHowMany nbOffspring = _parser.getORcreateParam(eoHowMany(1.0), "nbOffspring", "Nb of offspring (percentage or absolute)", '\0', "Evolution Engine").value();
+    eoParamParamType& ppReplace = _parser.getORcreateParam(eoParamParamType("Comma"), "replacement", "Replacement: Comma or Plus", '\0', "Evolution Engine").value();
+    bool weakElitism = _parser.getORcreateParam(false, "weakElitism", "Old best parent replaces new worst offspring *if necessary*", '\0', "Evolution Engine").value();
+    uint32_t seed = _parser.getORcreateParam(uint32_t(0), "seed", "Random number seed", '\0').value();
+    unsigned threads = _parser.getORcreateParam(unsigned(0), "threads", "Number of breeding threads, 0 for all cores", '\0', "Evolution Engine").value();
+
+#ifdef _OPENMP
+    if (threads > 0) omp_set_num_threads(threads);
+#endif
+
+    eoSelectOne<EOT>* select;
+    if (ppSelect.first == "Sequential")
+        select = new eoSequentialSelect<EOT>(ppSelect.second.size() == 0 || ppSelect.second[0] != "unordered");
+    else if (ppSelect.first == "Random")
+        select = new eoRandomSelect<EOT>;
+    else
+        throw runtime_error("Selection " + ppSelect.first + " is not supported by parallel breeder");
+    _state.storeFunctor(select);
+
+    eoReplacement<EOT>* replace;
+    if (ppReplace.first == "Comma")
+        replace = new eoCommaReplacement<EOT>;
+    else if (ppReplace.first == "Plus")
+        replace = new eoPlusReplacement<EOT>;
+    else
+        throw runtime_error("Replacement " + ppReplace.first + " is not supported by parallel breeder");
+    _state.storeFunctor(replace);
+
+    if (weakElitism)
+    {
+        replace = new eoWeakElitistReplacement<EOT>(*replace);
+        _state.storeFunctor(replace);
+    }
+
+    hadParallelBreeder<EOT>* breed = new hadParallelBreeder<EOT>(*select, _variation, _houseEval, _eval, nbOffspring, seed);
+    _state.storeFunctor(breed);
+    _runState.addValue("breeder", breed->generation);
+    do_make_operator_selector(_parser, _state, _variation, _runState);
+
+    eoAlgo<EOT>* algo = new eoEasyEA<EOT>(_continue, _eval, *breed, *replace);
+    _state.storeFunctor(algo);
+
+    return *algo;
+}
+
+#endif
@@ -0,0 +1,390 @@
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+// needs eo and evaluate.h to be included before
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+
+#include "telemetry.h"
+#include "trace.h"
+
+// Full state of a run: population, rng, counters and whatever else engine
+// adds, so a run resumes exactly where its last checkpoint was. .sav files
+// of eoCheckPoint only hold the population.
+//
+// State is written to a temporary file which then replaces checkpoint, so
+// a crash while writing leaves previous checkpoint. Writes are at least
+// --checkpointInterval seconds apart and never take more than 5% of run.
+
+class hadRunState : public eoUpdater
+{
+public:
+    unsigned long generation;
+
+    hadRunState(eoParser& _parser)
+        : generation(0), cost(0), at(0)
+    {
+        string resDir = _parser.getORcreateParam(string("Res"), "resDir", "Directory to store DISK outputs", '\0', "Output - Disk").value();
+        filename = _parser.createParam(string(""), "checkpoint", "File of full run state, resDir/checkpoint.state if empty", '\0', "Output - Disk").value();
+        interval = _parser.createParam(60.0, "checkpointInterval", "Minimum seconds between full state checkpoints, 0 for none", '\0', "Output - Disk").value();
+        at = _parser.createParam((unsigned long)0, "checkpointGeneration", "Generation of a full state checkpoint besides interval, 0 for none", '\0', "Output - Disk").value();
+        string resume = _parser.createParam(string(""), "resume", "Full state checkpoint to resume run from", '\0', "Output - Disk").value();
+
+        if (filename.empty())
+            filename = resDir + "/checkpoint.state";
+        last = Telemetry::now();
+
+        if (! resume.empty() && ! read(resume))
+            throw runtime_error("Could not resume from " + resume);
+
+        addValue("generation", generation);
+
+        // files of resumed run are kept, its continuators go on counting to
+        // maxGen and others of whole run
+        if (! resume.empty())
+            _parser.setORcreateParam(false, "eraseDir", "erase files in dirName if any", '\0', "Output - Disk");
+    }
+
+    ~hadRunState()
+    {
+        for (size_t i = 0; i < items.size(); i++)
+            delete items[i];
+    }
+
+    bool resumed() const
+    {
+        return ! saved.empty();
+    }
+
+    // parts of state, restored at once when resuming
+    void add(const string& name, eoPersistent& object)
+    {
+        insert(new ObjectItem(name, object));
+    }
+
+    template <class T>
+    void addValue(const string& name, T& value)
+    {
+        insert(new ValueItem<T>(name, value));
+    }
+
+    // end of a generation
+    void operator()()
+    {
+        generation++;
+        if (generation != at && interval <= 0)
+            return;
+
+        double now = Telemetry::now();
+        if (generation != at && now - last < max(interval, 20 * cost))
+            return;
+
+        TRACE_ZONE("checkpoint");
+        if (! write())
+            cerr << "Could not write checkpoint " << filename << endl;
+
+        last = Telemetry::now();
+        cost = last - now;
+    }
+
+    bool write()
+    {
+        ostringstream text;
+        text << "hadRunState 1\n";
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            ostringstream item;
+            item.precision(17); // doubles read back exactly
+            items[i]->print(item);
+            text << items[i]->name << ' ' << item.str().size() << '\n' << item.str() << '\n';
+        }
+
+        string content = text.str(), tmp = filename + ".tmp";
+        FILE* file = fopen(tmp.c_str(), "wb");
+        if (! file) return false;
+
+        bool written = fwrite(content.data(), 1, content.size(), file) == content.size() && fflush(file) == 0 && fsync(fileno(file)) == 0;
+        written = fclose(file) == 0 && written;
+        return written && rename(tmp.c_str(), filename.c_str()) == 0;
+    }
+
+private:
+    struct Item {
+        string name;
+
+        Item(const string& _name)
+            : name(_name)
+        {}
+
+        virtual ~Item()
+        {}
+
+        virtual void print(ostream& os) = 0;
+        virtual void read(istream& is) = 0;
+    };
+
+    struct ObjectItem : public Item {
+        eoPersistent& object;
+
+        ObjectItem(const string& _name, eoPersistent& _object)
+            : Item(_name), object(_object)
+        {}
+
+        void print(ostream& os) { object.printOn(os); }
+        void read(istream& is) { object.readFrom(is); }
+    };
+
+    template <class T>
+    struct ValueItem : public Item {
+        T& value;
+
+        ValueItem(const string& _name, T& _value)
+            : Item(_name), value(_value)
+        {}
+
+        void print(ostream& os) { os << value; }
+        void read(istream& is) { is >> value; }
+    };
+
+    string filename;
+    double interval, last, cost; // seconds
+    unsigned long at; // generation of a checkpoint besides interval
+    vector<Item*> items;
+    vector< pair<string, string> > saved; // of resumed run
+
+    void insert(Item* item)
+    {
+        items.push_back(item);
+
+        for (size_t i = 0; i < saved.size(); i++)
+            if (saved[i].first == item->name)
+            {
+                istringstream is(saved[i].second);
+                item->read(is);
+                if (is.fail())
+                    throw runtime_error("Could not resume " + item->name);
+            }
+    }
+
+    bool read(const string& resume)
+    {
+        ifstream file(resume.c_str(), ios::binary);
+        string header; int version;
+        if (! (file >> header >> version) || header != "hadRunState")
+            return false;
+
+        string name; size_t length;
+        while (file >> name >> length)
+        {
+            file.get(); // newline
+            string content(length, '\0');
+            if (length && ! file.read(&content[0], length))
+                return false;
+            saved.push_back(make_pair(name, content));
+        }
+
+        return ! saved.empty();
+    }
+};
+
+
+// runs state updater as last continuator of checkpoint, so state holds
+// generation as counted by continuators too
+template <class EOT>
+class hadRunStateContinue : public eoContinue<EOT>
+{
+public:
+    hadRunStateContinue(hadRunState& _runState)
+        : runState(_runState)
+    {}
+
+    bool operator()(const eoPop<EOT>&)
+    {
+        runState();
+        return true;
+    }
+
+    string className() const { return "hadRunStateContinue"; }
+
+private:
+    hadRunState& runState;
+};
+
+
+// Continuators
+
+// eoGenContinue and eoSteadyFitContinue with their counters in run state
+
+template <class EOT>
+class hadGenContinue : public eoContinue<EOT>
+{
+public:
+    unsigned long generation;
+
+    hadGenContinue(unsigned long _maxGen)
+        : generation(0), maxGen(_maxGen)
+    {}
+
+    bool operator()(const eoPop<EOT>&)
+    {
+        return ++generation < maxGen;
+    }
+
+    string className() const { return "hadGenContinue"; }
+
+private:
+    unsigned long maxGen;
+};
+
+// stops after steadyGen generations without improvement of best, counted
+// from minGen
+template <class EOT>
+class hadSteadyFitContinue : public eoContinue<EOT>
+{
+public:
+    typedef typename EOT::Fitness Fitness;
+
+    unsigned long generation, lastImprovement;
+    bool steady;
+    Fitness best;
+
+    hadSteadyFitContinue(unsigned long _minGen, unsigned long _steadyGen)
+        : generation(0), lastImprovement(0), steady(false), best(Fitness()), minGen(_minGen), steadyGen(_steadyGen)
+    {}
+
+    bool operator()(const eoPop<EOT>& _pop)
+    {
+        generation++;
+        Fitness current = _pop.nth_element_fitness(0);
+        if (! steady)
+        {
+            if (generation > minGen)
+            {
+                steady = true;
+                best = current;
+                lastImprovement = generation;
+            }
+        }
+        else if (current > best)
+        {
+            best = current;
+            lastImprovement = generation;
+        }
+        else if (generation - lastImprovement > steadyGen)
+            return false;
+        return true;
+    }
+
+    string className() const { return "hadSteadyFitContinue"; }
+
+private:
+    unsigned long minGen, steadyGen;
+};
+
+// criteria of do_make_continue, steady and target fitness only for scalar
+// fitness; all counters of continuators are in run state
+template <class EOT>
+eoContinue<EOT>& do_make_continue(eoParser& _parser, eoState& _state, eoEvalFuncCounter<EOT>& _eval, hadRunState& _runState, bool _scalar = true)
+{
+    eoCombinedContinue<EOT>* continuator = 0;
+    vector<eoContinue<EOT>*> criteria;
+
+    unsigned maxGen = _parser.getORcreateParam(unsigned(100), "maxGen", "Maximum number of generations () = none)", 'G', "Stopping criterion").value();
+    if (maxGen)
+    {
+        hadGenContinue<EOT>* genContinue = new hadGenContinue<EOT>(maxGen);
+        _runState.addValue("genContinue", genContinue->generation);
+        criteria.push_back(genContinue);
+    }
+
+    if (_scalar)
+    {
+        unsigned steadyGen = _parser.createParam(unsigned(100), "steadyGen", "Number of generations with no improvement", 's', "Stopping criterion").value();
+        unsigned minGen = _parser.createParam(unsigned(0), "minGen", "Minimum number of generations", 'g', "Stopping criterion").value();
+        if (steadyGen)
+        {
+            hadSteadyFitContinue<EOT>* steadyContinue = new hadSteadyFitContinue<EOT>(minGen, steadyGen);
+            _runState.addValue("steadyGeneration", steadyContinue->generation);
+            _runState.addValue("steadyImprovement", steadyContinue->lastImprovement);
+            _runState.addValue("steady", steadyContinue->steady);
+            _runState.addValue("steadyBest", steadyContinue->best);
+            criteria.push_back(steadyContinue);
+        }
+    }
+
+    // counter of evaluations is in run state of engine
+    unsigned long maxEval = _parser.getORcreateParam((unsigned long)0, "maxEval", "Maximum number of evaluations (0 = none)", 'E', "Stopping criterion").value();
+    if (maxEval)
+        criteria.push_back(new eoEvalContinue<EOT>(_eval, maxEval));
+
+    if (_scalar)
+    {
+        eoValueParam<double>& targetFitness = _parser.createParam(0.0, "targetFitness", "Stop when fitness reaches", 'T', "Stopping criterion");
+        if (_parser.isItThere(targetFitness))
+            criteria.push_back(new eoFitContinue<EOT>(targetFitness.value()));
+    }
+
+    bool ctrlC = _parser.createParam(false, "CtrlC", "Terminate current generation upon Ctrl C", 'C', "Stopping criterion").value();
+    if (ctrlC)
+        criteria.push_back(new eoCtrlCContinue<EOT>);
+
+    if (criteria.empty())
+        throw runtime_error("You MUST provide a stopping criterion");
+
+    for (size_t i = 0; i < criteria.size(); i++)
+    {
+        _state.storeFunctor(criteria[i]);
+        if (! continuator)
+        {
+            continuator = new eoCombinedContinue<EOT>(*criteria[i]);
+            _state.storeFunctor(continuator);
+        }
+        else
+            continuator->add(*criteria[i]);
+    }
+    return *continuator;
+}
+
+
+// Telemetry
+
+// owns telemetry of run, closes its row at end of each generation, so
+// updaters writing into row are added to checkpoint before it
+class hadTelemetryUpdater : public eoUpdater
+{
+public:
+    Telemetry telemetry;
+
+    ~hadTelemetryUpdater()
+    {
+        if (House::house->telemetry == &telemetry)
+            House::house->telemetry = 0;
+    }
+
+    void operator()()
+    {
+        telemetry.nextGeneration();
+    }
+};
+
+// telemetry of run, next to generation files, counted on main house
+hadTelemetryUpdater& do_make_telemetry(eoParser& _parser, eoState& _state, hadRunState& _runState)
+{
+    string resDir = _parser.getORcreateParam(string("Res"), "resDir", "Directory to store DISK outputs", '\0', "Output - Disk").value();
+
+    hadTelemetryUpdater* updater = new hadTelemetryUpdater;
+    _state.storeFunctor(updater);
+    updater->telemetry.open((resDir + "/telemetry.csv").c_str(), _runState.resumed());
+    House::house->telemetry = &updater->telemetry;
+
+    _runState.addValue("telemetryGeneration", updater->telemetry.generation);
+    _runState.addValue("telemetryEvaluations", updater->telemetry.evaluations);
+    return *updater;
+}
+
+#endif
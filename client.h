@@ -0,0 +1,159 @@
+
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <vector>
+#include <string>
+using namespace std;
+
+// Client of evaluation server (server.cpp), for tools which score plans
+// without evaluate.h. A request is a batch of genomes of same length, its
+// response has components of each plan in order. Requests may be
+// pipelined, sent one after another before their responses are received,
+// which come in order of requests; requests beyond what socket buffers
+// hold wait until responses are received.
+//
+// Frames are a header, then count genomes of genes doubles in requests, or
+// count scores in responses, native endian as server is local. Responses
+// have genes of problem; a request of no genomes asks for them, one of
+// other genes has a response of no scores.
+
+const uint32_t frameMagic = 0x31444148; // "HAD1"
+
+struct FrameHeader {
+    uint32_t magic, id, count, genes;
+};
+
+// components of a plan's value, as Evaluation of evaluate.h
+struct PlanScore {
+    double area, intersection, side, access, space, light;
+    double total; // penalties minus profits
+};
+
+inline bool receiveFull(int socket, void* data, size_t size)
+{
+    char* bytes = (char*) data;
+    while (size > 0)
+    {
+        ssize_t received = recv(socket, bytes, size, 0);
+        if (received <= 0)
+            return false;
+        bytes += received; size -= received;
+    }
+    return true;
+}
+
+// header and data in one call, as far as socket takes them
+inline bool sendFrame(int socket, const FrameHeader& header, const void* data, size_t size)
+{
+    iovec parts[2] = {{(void*) &header, sizeof(header)}, {(void*) data, size}};
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = parts;
+    message.msg_iovlen = size ? 2 : 1;
+
+    while (message.msg_iovlen > 0)
+    {
+        ssize_t sent = sendmsg(socket, &message, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return false;
+
+        while (message.msg_iovlen > 0 && size_t(sent) >= message.msg_iov->iov_len)
+        {
+            sent -= message.msg_iov->iov_len;
+            message.msg_iov++; message.msg_iovlen--;
+        }
+        if (message.msg_iovlen > 0)
+        {
+            message.msg_iov->iov_base = (char*) message.msg_iov->iov_base + sent;
+            message.msg_iov->iov_len -= sent;
+        }
+    }
+    return true;
+}
+
+class EvaluationClient {
+public:
+    EvaluationClient()
+        : socket(-1), next(0)
+    {}
+
+    ~EvaluationClient()
+    {
+        close();
+    }
+
+    bool open(const string& path)
+    {
+        close();
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            return false;
+        strcpy(address.sun_path, path.c_str());
+
+        socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socket < 0 || connect(socket, (sockaddr*) &address, sizeof(address)) < 0)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (socket >= 0)
+            ::close(socket);
+        socket = -1;
+    }
+
+    // genes of problem, 0 on errors, with no requests waiting
+    uint32_t genes()
+    {
+        uint32_t id;
+        vector<PlanScore> scores;
+        FrameHeader header;
+        if (! send(0, 0, 0, id) || ! receive(header, scores))
+            return 0;
+        return header.genes;
+    }
+
+    // a batch of count genomes, id of its response is returned
+    bool send(const double* genomes, uint32_t count, uint32_t genes, uint32_t& id)
+    {
+        FrameHeader header = {frameMagic, next++, count, genes};
+        id = header.id;
+        return sendFrame(socket, header, genomes, size_t(count) * genes * sizeof(double));
+    }
+
+    // next response, in order of requests
+    bool receive(FrameHeader& header, vector<PlanScore>& scores)
+    {
+        if (! receiveFull(socket, &header, sizeof(header)) || header.magic != frameMagic)
+            return false;
+        scores.resize(header.count);
+        return header.count == 0 || receiveFull(socket, &scores[0], header.count * sizeof(PlanScore));
+    }
+
+    // one round trip, false if server did not score them
+    bool evaluate(const double* genomes, uint32_t count, uint32_t genes, vector<PlanScore>& scores)
+    {
+        uint32_t id;
+        FrameHeader header;
+        return send(genomes, count, genes, id) && receive(header, scores) && header.id == id && header.count == count;
+    }
+
+private:
+    int socket;
+    uint32_t next;
+};
+
+#endif
@@ -0,0 +1,137 @@
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <string>
+#include <string.h>
+using namespace std;
+
+// Compression of generation files: "HADZ", original size as 4 bytes little
+// endian, then one LZ4 block. Sequences of a block are a token (literal
+// length << 4 | match length - 4, 15 continued by 255 bytes), literals and a
+// 2 byte offset of match, last sequence has only literals.
+
+const char lzMagic[] = "HADZ";
+const size_t lzHeader = 8, lzMinMatch = 4, lzLastLiterals = 5, lzMatchLimit = 12, lzHashBits = 12;
+
+inline unsigned lzRead32(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned) p[3] << 24);
+}
+
+inline void lzPutLength(string& out, size_t length)
+{
+    for (; length >= 255; length -= 255)
+        out += (char) 255;
+    out += (char) length;
+}
+
+inline void lzPutSequence(string& out, const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    size_t match = matchLength ? matchLength - lzMinMatch : 0;
+    out += (char) ((min<size_t>(literalLength, 15) << 4) | min<size_t>(match, 15));
+    if (literalLength >= 15)
+        lzPutLength(out, literalLength - 15);
+    out.append((const char*) literals, literalLength);
+
+    if (! matchLength)
+        return;
+
+    out += (char) (offset & 0xff);
+    out += (char) (offset >> 8);
+    if (match >= 15)
+        lzPutLength(out, match - 15);
+}
+
+inline bool isCompressed(const char* data, size_t size)
+{
+    return size >= lzHeader && memcmp(data, lzMagic, 4) == 0;
+}
+
+// greedy matching over a hash table of 4 byte sequences
+inline string lzCompress(const string& text)
+{
+    const unsigned char* in = (const unsigned char*) text.data();
+    const size_t size = text.size();
+
+    string out(lzMagic, 4);
+    for (int i = 0; i < 4; i++)
+        out += (char) ((size >> (8*i)) & 0xff);
+
+    size_t table[1 << lzHashBits];
+    for (size_t i = 0; i < (1 << lzHashBits); i++)
+        table[i] = size;
+
+    size_t anchor = 0, p = 0;
+    while (size >= lzMatchLimit && p + lzMatchLimit <= size)
+    {
+        unsigned sequence = lzRead32(in + p);
+        size_t& entry = table[(sequence * 2654435761u) >> (32 - lzHashBits)];
+        size_t candidate = entry;
+        entry = p;
+
+        if (candidate == size || p - candidate > 0xffff || lzRead32(in + candidate) != sequence)
+        {
+            p++;
+            continue;
+        }
+
+        size_t length = lzMinMatch;
+        while (p + length < size - lzLastLiterals && in[candidate + length] == in[p + length])
+            length++;
+
+        lzPutSequence(out, in + anchor, p - anchor, p - candidate, length);
+        p += length;
+        anchor = p;
+    }
+
+    lzPutSequence(out, in + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+inline bool lzDecompress(const char* data, size_t size, string& text)
+{
+    if (! isCompressed(data, size))
+        return false;
+
+    const unsigned char *in = (const unsigned char*) data, *end = in + size;
+    size_t length = lzRead32(in + 4);
+    text.clear();
+    text.reserve(min(length, size * 255));
+
+    for (in += lzHeader; in < end; )
+    {
+        unsigned token = *in++;
+
+        size_t literals = token >> 4;
+        if (literals == 15)
+            for (unsigned char b = 255; b == 255 && in < end; literals += b)
+                b = *in++;
+        if ((size_t) (end - in) < literals)
+            return false;
+        text.append((const char*) in, literals);
+        in += literals;
+
+        // last sequence
+        if (in == end)
+            break;
+        if (end - in < 2)
+            return false;
+
+        size_t offset = in[0] | (in[1] << 8), match = (token & 15) + lzMinMatch;
+        in += 2;
+        if ((token & 15) == 15)
+            for (unsigned char b = 255; b == 255 && in < end; match += b)
+                b = *in++;
+        if (offset == 0 || offset > text.size())
+            return false;
+
+        // overlapping matches repeat their bytes
+        for (size_t start = text.size() - offset, i = 0; i < match; i++)
+            text += text[start + i];
+    }
+
+    return text.size() == length;
+}
+
+#endif
@@ -0,0 +1,149 @@
+
+#ifndef DIVERSITY_H
+#define DIVERSITY_H
+
+// needs eo, evaluate.h and operators.h to be included before
+
+#include <math.h>
+#include <stdexcept>
+
+#include "checkpoint.h"
+
+// Genotype spread of population at end of each generation, in O(N·d):
+// deviation is mean over genes of their standard deviation, distance is
+// mean genomeDiff (L∞, as of GUI) of individuals to centroid, which bounds
+// half of mean pairwise genomeDiff. Both are in metres.
+//
+// When distance stays below threshold for patience generations, population
+// is renewed by policy: Restart keeps elite best individuals and draws the
+// rest again, Immigrants replaces the worst share of population by new
+// random individuals. Renewed individuals are evaluated at once.
+
+template <class EOT>
+class hadDiversityMonitor : public eoUpdater
+{
+public:
+    enum Policy { None, Restart, Immigrants };
+
+    double deviation, distance; // of last generation
+    unsigned long below, restarts; // generations below threshold, renewals
+
+    hadDiversityMonitor(eoPop<EOT>& _pop, eoInit<EOT>& _init, eoEvalFunc<EOT>& _eval, Telemetry* _telemetry, Policy _policy = None, double _threshold = 0, unsigned _patience = 1, double _immigrants = 0, unsigned _elite = 1)
+        : deviation(0), distance(0), below(0), restarts(0), pop(_pop), init(_init), eval(_eval), telemetry(_telemetry), policy(_policy), threshold(_threshold), patience(_patience), immigrants(_immigrants), elite(_elite)
+    {}
+
+    void operator()()
+    {
+        TRACE_ZONE("diversity");
+
+        measure();
+        if (telemetry)
+        {
+            telemetry->geneDeviation = deviation;
+            telemetry->centroidDistance = distance;
+            telemetry->restarts = restarts;
+        }
+
+        if (policy == None || distance >= threshold)
+        {
+            below = 0;
+            return;
+        }
+        if (++below < patience)
+            return;
+
+        renew();
+        below = 0;
+        restarts++;
+        if (telemetry)
+            telemetry->restarts = restarts;
+    }
+
+    string className() const { return "hadDiversityMonitor"; }
+
+private:
+    eoPop<EOT>& pop;
+    eoInit<EOT>& init;
+    eoEvalFunc<EOT>& eval;
+    Telemetry* telemetry;
+    Policy policy;
+    double threshold;
+    unsigned patience;
+    double immigrants;
+    unsigned elite;
+
+    void measure()
+    {
+        size_t count = pop.size(), genes = count ? pop[0].size() : 0;
+        deviation = distance = 0;
+        if (count == 0 || genes == 0)
+            return;
+
+        vector<double> centroid(genes, 0);
+        for (size_t i = 0; i < count; i++)
+            for (size_t k = 0; k < genes; k++)
+                centroid[k] += geneValue(pop[i][k]);
+        for (size_t k = 0; k < genes; k++)
+            centroid[k] /= count;
+
+        vector<double> squares(genes, 0);
+        for (size_t i = 0; i < count; i++)
+        {
+            double farthest = 0;
+            for (size_t k = 0; k < genes; k++)
+            {
+                double diff = geneValue(pop[i][k]) - centroid[k];
+                squares[k] += diff * diff;
+                farthest = max(farthest, fabs(diff));
+            }
+            distance += farthest;
+        }
+        distance /= count;
+
+        for (size_t k = 0; k < genes; k++)
+            deviation += sqrt(squares[k] / count);
+        deviation /= genes;
+    }
+
+    void renew()
+    {
+        TRACE_ZONE("renew");
+
+        size_t kept = pop.size();
+        if (policy == Restart)
+            kept = min<size_t>(elite, pop.size());
+        else if (policy == Immigrants)
+            kept = pop.size() - min(pop.size(), size_t(immigrants * pop.size() + 0.5));
+
+        pop.sort(); // best first
+        for (size_t i = kept; i < pop.size(); i++)
+        {
+            init(pop[i]);
+            eval(pop[i]);
+        }
+    }
+};
+
+template <class EOT>
+hadDiversityMonitor<EOT>& do_make_diversity(eoParser& _parser, eoState& _state, eoPop<EOT>& _pop, eoInit<EOT>& _init, eoEvalFunc<EOT>& _eval, Telemetry* _telemetry, hadRunState& _runState)
+{
+    string policy = _parser.createParam(string("None"), "diversityPolicy", "On diversity collapse: None, Restart or Immigrants", '\0', "Evolution Engine").value();
+    double minDiversity = _parser.createParam(0.05, "minDiversity", "Mean genomeDiff to centroid (m) below which population has collapsed", '\0', "Evolution Engine").value();
+    unsigned patience = _parser.createParam(unsigned(10), "diversityPatience", "Generations of collapse before population is renewed", '\0', "Evolution Engine").value();
+    double immigrants = _parser.createParam(0.2, "immigrantRate", "Share of population replaced by immigrants", '\0', "Evolution Engine").value();
+    unsigned elite = _parser.createParam(unsigned(1), "restartElite", "Best individuals kept by restarts", '\0', "Evolution Engine").value();
+
+    typename hadDiversityMonitor<EOT>::Policy p;
+    if (policy == "None") p = hadDiversityMonitor<EOT>::None;
+    else if (policy == "Restart") p = hadDiversityMonitor<EOT>::Restart;
+    else if (policy == "Immigrants") p = hadDiversityMonitor<EOT>::Immigrants;
+    else throw runtime_error("Diversity policy " + policy + " is not supported");
+
+    hadDiversityMonitor<EOT>* monitor = new hadDiversityMonitor<EOT>(_pop, _init, _eval, _telemetry, p, minDiversity, max(patience, 1u), immigrants, elite);
+    _state.storeFunctor(monitor);
+    _runState.addValue("diversityBelow", monitor->below);
+    _runState.addValue("restarts", monitor->restarts);
+    return *monitor;
+}
+
+#endif
@@ -9,85 +9,26 @@
 #include <eo>
 #include <es/make_es.h>
 #include <eoRealOp.h>
+#include <do/make_pop.h>
+#include <do/make_continue.h>
+#include <do/make_checkpoint.h>
+#include <do/make_algo_scalar.h>
+#include <do/make_run.h>
 
 using namespace std;
 
 #include "/home/alireza/repo/had/evaluate.h"
+#include "/home/alireza/repo/had/operators.h"
+#include "/home/alireza/repo/had/breeder.h"
+#include "/home/alireza/repo/had/saver.h"
+#include "/home/alireza/repo/had/diversity.h"
+#include "/home/alireza/repo/had/fidelity.h"
 
 
 // Operators
 
-template<class GenotypeT>
-class RoomExchangeCrossover: public eoQuadOp<GenotypeT>
-{
-    const double pCrossExchange;
-
-public:
-    RoomExchangeCrossover(double _pExchange = 0.1)
-        : pCrossExchange(_pExchange)
-    {}
-
-    string className() const { return "RoomExchangeCrossover"; }
-
-    // modifies both parents
-    bool operator()(GenotypeT& g1, GenotypeT & g2)
-    {
-        bool oneAtLeastIsModified(false);
-
-        double tmp;
-        const size_t rooms = House::house->rooms;
-        for (size_t t, j, i = 0; i < rooms; i++)
-            if (rng.flip(pCrossExchange))
-            {
-                for (t = 4*i, j = 0; j < 4; j++)
-                {
-                    tmp = g1[t+j];
-                    g1[t+j] = g2[t+j];
-                    g2[t+j] = tmp;
-                }
-
-                if (!oneAtLeastIsModified) oneAtLeastIsModified = true;
-            }
-
-        return oneAtLeastIsModified;
-    }
-};
-
-template<class GenotypeT>
-class RoomSwapMutation: public eoMonOp<GenotypeT>
-{
-public:
-
-    string className() const { return "RoomSwapMutation"; }
-
-    // modifies parent
-    bool operator()(GenotypeT& g)
-    {
-        bool isModified(false);
-
-        const int rooms = House::house->rooms;
-        size_t first = rooms * rng.uniform(), second = rooms * rng.uniform();
-        first *= 4; second *= 4;
-
-        if (first != second)
-        {
-            double  x1 = g[second] + (g[second+2] - g[first+2]) / 2,
-                    y1 = g[second+1] + (g[second+3] - g[first+3]) / 2,
-                    x2 = g[first] + (g[first+2] - g[second+2]) / 2,
-                    y2 = g[first+1] + (g[first+3] - g[second+3]) / 2;
-
-            g[first] = x1; g[first+1] = y1;
-            g[second] = x2; g[second+1] = y2;
-
-            isModified = true;
-        }
-
-        return isModified;
-    }
-};
-
 template <class EOT>
-eoGenOp<EOT> & do_make_op(EOT, eoParser& parser, eoState& state)
+eoGenOp<EOT> & do_make_op(EOT, eoParser& parser, eoState& state, hadVariation<EOT>& variation)
 {
     double  pCross = parser.createParam(0.1, "pCross", "Crossover probability",'C',"Param").value(),
             pRoomExchangeCross = parser.createParam(0.1, "pRoomExchangeCross", "Room exchange probability in Crossover",'E',"Param").value(),
@@ -100,18 +41,23 @@ eoGenOp<EOT> & do_make_op(EOT, eoParser& parser, eoState& state)
     eoPropCombinedQuadOp<EOT>* xover;
     state.storeFunctor(xover);
     eoPropCombinedMonOp<EOT>* mutation;
-    eoMonOp<EOT> *ptMon;
+    StreamMonOp<EOT> *ptMon;
     state.storeFunctor(mutation);
 
     // xover
-    ptQuad = new RoomExchangeCrossover<EOT>(pRoomExchangeCross);
-    xover = new eoPropCombinedQuadOp<EOT>(*ptQuad, 1); state.storeFunctor(ptQuad);
+    RoomExchangeCrossover<EOT>* roomExchange = new RoomExchangeCrossover<EOT>(pRoomExchangeCross);
+    xover = new eoPropCombinedQuadOp<EOT>(*roomExchange, 1); state.storeFunctor(roomExchange);
+    variation.xover = roomExchange;
+    variation.pCross = pCross;
+    variation.pMut = pMut;
 
     // mutation
-    ptMon = new eoUniformMutation<EOT>(mutEpsilon);
+    ptMon = new UniformMutation<EOT>(mutEpsilon);
     mutation = new eoPropCombinedMonOp<EOT>(*ptMon, 1); state.storeFunctor(ptMon);
+    variation.add(*ptMon, 1);
     ptMon = new RoomSwapMutation<EOT>;
     mutation->add(*ptMon, pRoomSwapMut); state.storeFunctor(ptMon);
+    variation.add(*ptMon, pRoomSwapMut);
 
     // a proportional combination of a QuadCopy and crossover
     eoProportionalOp<EOT>* cross = new eoProportionalOp<EOT> ; state.storeFunctor(cross);
@@ -128,10 +74,28 @@ eoGenOp<EOT> & do_make_op(EOT, eoParser& parser, eoState& state)
 }
 
 
-// Algorithm
+// Genotype
 
 typedef eoMinimizingFitness  FitT;
 
+eoInit< eoReal<FitT> >& do_make_genotype(eoParser& _parser, eoState& _state, eoReal<FitT> _eo)
+{
+    return make_genotype(_parser, _state, _eo);
+}
+
+// same initBounds as make_genotype, which do_make_problem has created
+eoInit< eoQuantized<FitT> >& do_make_genotype(eoParser& _parser, eoState& _state, eoQuantized<FitT>)
+{
+    eoRealVectorBounds& bounds = _parser.getORcreateParam(eoRealVectorBounds(), "initBounds", "Bounds for initialization (MUST be bounded)", 'B', "Genotype Initialization").value();
+
+    hadQuantizedInit< eoQuantized<FitT> >* init = new hadQuantizedInit< eoQuantized<FitT> >(bounds);
+    _state.storeFunctor(init);
+    return *init;
+}
+
+
+// Algorithm
+
 template <class EOT>
 void runAlgorithm(EOT, eoParser& _parser, eoState& _state);
 
@@ -140,7 +104,13 @@ int main_function(int argc, char *argv[])
     eoParser parser(argc, argv); // for user-parameter reading
     eoState state; // keeps all things allocated
 
-    runAlgorithm(eoReal<FitT>(), parser, state);
+    string genome = parser.createParam(string("Real"), "genome", "Genes: Real metres or Quantized int16 centimetres", '\0', "Genotype Initialization").value();
+    if (genome == "Real")
+        runAlgorithm(eoReal<FitT>(), parser, state);
+    else if (genome == "Quantized")
+        runAlgorithm(eoQuantized<FitT>(), parser, state);
+    else
+        throw runtime_error("Genome " + genome + " is not supported");
 
     return 0;
 }
@@ -166,22 +136,51 @@ void runAlgorithm(EOT, eoParser& _parser, eoState& _state)
     typedef typename EOT::Fitness FitT;
 
     // The evaluation fn - encapsulated into an eval counter for output
-    eoEvalFuncPtr<EOT, double, const std::vector<double>&> mainEval( real_value );
-    eoEvalFuncCounter<EOT> eval(mainEval);
+    hadScalarEval<EOT> mainEval(do_make_repair(_parser));
+    hadFidelityEval<EOT>& fidelityEval = do_make_fidelity_eval(_parser, _state, mainEval);
+    eoEvalFuncCounter<EOT> eval(fidelityEval);
 
-    eoRealInitBounded<EOT>& init = make_genotype(_parser, _state, EOT());
+    do_make_problem(_parser);
+    hadRunState runState(_parser);
+    eoInit<EOT>& init = do_make_genotype(_parser, _state, EOT());
 
-    eoGenOp<EOT>& op = do_make_op(EOT(), _parser, _state);
+    hadVariation<EOT> variation;
+    eoGenOp<EOT>& op = do_make_op(EOT(), _parser, _state, variation);
 
     // initialize the population - and evaluate
-    eoPop<EOT>& pop = make_pop(_parser, _state, init);
+    eoPop<EOT>& pop = do_make_pop(_parser, _state, init);
+    runState.add("population", pop);
+    runState.add("rng", rng);
+    runState.addValue("evaluations", eval.value());
     apply<EOT>(eval, pop);
 
-    eoContinue<EOT> & term = make_continue(_parser, _state, eval);
-    eoCheckPoint<EOT> & checkpoint = make_checkpoint(_parser, _state, eval, term);
-    eoAlgo<EOT>& ga = make_algo_scalar(_parser, _state, eval, checkpoint, op);
+    eoContinue<EOT> & term = do_make_continue(_parser, _state, eval, runState);
+    hadAsyncSaver<EOT>* saver = do_make_async_saver(_parser, _state, pop, runState);
+    eoCheckPoint<EOT> & checkpoint = do_make_checkpoint(_parser, _state, eval, term);
+
+    // coarse fidelity of early generations, before population is saved
+    checkpoint.add(do_make_fidelity_schedule(_parser, _state, pop, fidelityEval, eval, runState));
+    if (saver) checkpoint.add(*saver);
+
+    // telemetry of run, next to generation files
+    string resDir = _parser.getORcreateParam(string("Res"), "resDir", "Directory to store DISK outputs", '\0', "Output - Disk").value();
+    hadTelemetryUpdater& telemetryUpdater = do_make_telemetry(_parser, _state, runState);
+    Telemetry& telemetry = telemetryUpdater.telemetry;
+
+    // spread of population, before telemetry row is closed
+    checkpoint.add(do_make_diversity(_parser, _state, pop, init, eval, &telemetry, runState));
+
+    checkpoint.add(telemetryUpdater);
+    // breed and evaluate offspring on all cores
+    bool parallel = _parser.createParam(false, "parallel", "Breed and evaluate offspring in parallel", '\0', "Evolution Engine").value();
+    eoAlgo<EOT>& ga = parallel ? do_make_algo_parallel(_parser, _state, eval, checkpoint, variation, fidelityEval, runState) : do_make_algo_scalar(_parser, _state, eval, checkpoint, do_make_op_serial(_parser, _state, eval, checkpoint, op, variation, runState));
+
+    // full state after all other updaters and continuators of generation
+    hadRunStateContinue<EOT> runStateContinue(runState);
+    checkpoint.add(runStateContinue);
 
-    run_ea(ga, pop);
+    do_run(ga, pop);
+    TRACE_WRITE((resDir + "/trace.json").c_str());
 
     make_help(_parser);
     // pop.sortedPrintOn(cout);
@@ -4,10 +4,18 @@
 
 #include <algorithm>
 #include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <string.h>
 #include <math.h>
 using namespace std;
 
-typedef const std::vector<double>& GENOME;
+#include "telemetry.h"
+#include "json.h"
+#include "genome.h"
+
+typedef GenomeView GENOME;
 
 const double areaCoeff = 3, intersectionCoeff = 3, sideCoeff = 0.25, accessCoeff = 1.5, lightCoeff = 0.25, spaceCoeff = 0.75;
 
@@ -103,8 +111,15 @@ void addRectanglePoints(vector<Point>& points, Rect& r)
 
 // Problem
 
+// components of a plan's value, profits are positive
+struct Evaluation {
+    double area, intersection, side, access, space, light;
+    double total; // penalties minus profits
+};
+
 class Room {
 public:
+    string name;
     int lightLimit; // lights // 0: no light, 1: middle, 2: extreme
     double areaLimit;
     Size sizeLimit;
@@ -127,12 +142,22 @@ public:
     Rect space;
     double original_width, original_height;
     double out_wall, wall;
-    int* access;
+
+    struct AccessEdge {
+        int from, to; // rooms, -1 for access space
+    };
+    vector<AccessEdge> edges;
+    int start; // room access starts from, -1 for access space
     int light[4]; // clockwise // 0: up, 1: right, 2: down, 3: left
 
     static House* house;
+    Telemetry* telemetry;
+    unsigned long evaluations; // calls of evaluate
+    int webSize; // probes per side of space detection, 0 for full fidelity
+    vector<double> decoded; // metres of quantized genes being evaluated
 
     House()
+        : telemetry(0), evaluations(0), webSize(0)
     {
         original_width = 10.6;
         original_height = 10.05;
@@ -149,6 +174,10 @@ public:
         for (int i = 0; i < rooms; i++)
             room.push_back(Room());
 
+        const char* names[] = {"kitchen", "bedroom1", "bedroom2", "bathroom", "toilet", "stairs", "elevator"};
+        for (int i = 0; i < rooms; i++)
+            room[i].name = names[i];
+
         // Area
         room[5].sizeLimit.height = 2.5; room[5].sizeLimit.width = 4.5; // stairs
         room[6].sizeLimit.height = 1.6; room[6].sizeLimit.width = 2; // elevator
@@ -167,74 +196,280 @@ public:
 
 
         // Access
-        access = new int[rooms];
+        start = -1;
         for (int i = 0; i < rooms; i++)
-            access[i] = -1; // rooms are directly accessible from access space including living room and corridors
-        access[6] = 5; // "stairs": ["elevator"]
+            if (i != 6) addEdge(-1, i); // rooms are directly accessible from access space including living room and corridors
+        addEdge(5, 6); // "stairs": ["elevator"]
 
         // Lights
         room[0].lightLimit = 1; room[1].lightLimit = 1; room[2].lightLimit = 1; // kitchen, bedroom1, bedroom2
 
     }
 
+    int roomIndex(const string& name)
+    {
+        for (int i = 0; i < rooms; i++)
+            if (room[i].name == name) return i;
+        return -1;
+    }
+
+    void addEdge(int from, int to)
+    {
+        AccessEdge edge = {from, to};
+        edges.push_back(edge);
+    }
+
+    // reads a problem file like problem.json, house is unchanged on errors
+    bool load(const char* filename)
+    {
+        ifstream file(filename);
+        stringstream content;
+        content << file.rdbuf();
+
+        Json json;
+        if (! file || ! Json::parse(content.str(), json))
+            return false;
+
+        const Json& problem = json.has("house") ? json["house"] : json;
+
+        const Json &jspace = problem["space"], &jrooms = problem["rooms"], &jaccess = problem["access"];
+        if (jrooms.type != Json::Object)
+            return false;
+
+        // Space, at full fidelity as a coarse webSize was of previous space
+        webSize = 0;
+        original_width = jspace.get("width", original_width);
+        original_height = jspace.get("height", original_height);
+        wall = jspace.get("wall", wall); out_wall = jspace.get("out wall", out_wall);
+        space.set(0, 0, original_width - (2*out_wall - wall), original_height - (2*out_wall - wall));
+
+        const Json& jlight = jspace["light"];
+        for (int i = 0; i < 4 && i < jlight.items.size(); i++)
+            light[i] = int(jlight.items[i].number);
+
+        // Rooms, except access space which is what remains empty
+        string accessSpace = jaccess["space"].text;
+
+        room.clear();
+        double shares = 0;
+        for (size_t i = 0; i < jrooms.keys.size(); i++)
+        {
+            const Json& jroom = jrooms.items[i];
+            shares += jroom.get("share", 0);
+
+            if (jrooms.keys[i] == accessSpace)
+                continue;
+
+            Room r;
+            r.name = jrooms.keys[i];
+            r.lightLimit = int(jroom.get("light", 0));
+            r.sizeLimit.width = jroom.get("width", 0);
+            r.sizeLimit.height = jroom.get("height", 0);
+            r.areaLimit = jroom.get("area", 0);
+            room.push_back(r);
+        }
+        rooms = room.size();
+
+        // Area, as share of space not taken by fixed size rooms
+        double emptySpace = space.getWidth() * space.getHeight();
+        for (int i = 0; i < rooms; i++)
+            if (room[i].sizeLimit.width)
+                emptySpace -= (room[i].sizeLimit.height + wall) * (room[i].sizeLimit.width + wall);
+
+        for (int i = 0; i < rooms; i++)
+        {
+            double share = jrooms[room[i].name].get("share", 0);
+            if (share && shares)
+                room[i].areaLimit = emptySpace * share / shares;
+        }
+
+        // Access, "edges": {"from": ["to", ...]}, rooms out of edges are
+        // accessed from access space
+        edges.clear();
+        start = roomIndex(jaccess["start"].text);
+
+        const Json& jedges = jaccess["edges"];
+        vector<bool> linked(rooms, false);
+        for (size_t i = 0; i < jedges.keys.size(); i++)
+        {
+            int from = jedges.keys[i] == accessSpace ? -1 : roomIndex(jedges.keys[i]);
+            if (from == -1 && jedges.keys[i] != accessSpace)
+                continue;
+
+            for (size_t j = 0; j < jedges.items[i].items.size(); j++)
+            {
+                string name = jedges.items[i].items[j].text;
+                int to = name == accessSpace ? -1 : roomIndex(name);
+                if (from == to || (to == -1 && name != accessSpace))
+                    continue;
+
+                addEdge(from, to);
+                if (from >= 0) linked[from] = true;
+                if (to >= 0) linked[to] = true;
+            }
+        }
+
+        for (int i = 0; i < rooms; i++)
+            if (! linked[i] && i != start)
+                addEdge(-1, i);
+
+        points.clear();
+        return true;
+    }
+
     void update(GENOME genome)
     {
+        TRACE_ZONE("update");
+
         // rooms
         for (int i = 0; i < rooms; i++)
         {
             int index = 4 * i;
             room[i].rect.set(genome[index], genome[index+1], genome[index] + genome[index+2], genome[index+1] + genome[index+3]);
         }
+
+        updateGraph();
+    }
+
+    // Adjacency graph of rooms, one sweep and prune pass per plan. Rooms are
+    // neighbors if they are closer than a door width, access space is linked
+    // to rooms in updateSpaces.
+
+    struct Neighbor {
+        int room;
+        double wall, distance; // shared wall length, access distance
+    };
+    vector< vector<Neighbor> > graph;
+    vector<Neighbor> spaceLinks; // nearest access space of each room
+    vector<double> sides; // side distances of each room
+    double overlaps; // sum of room intersections
+
+    void updateGraph()
+    {
+        const double reach = 1; // door width
+
+        graph.resize(rooms);
+        sides.resize(4 * rooms);
+        for (int i = 0; i < rooms; i++)
+        {
+            graph[i].clear();
+            getSideDistances(room[i].rect, &sides[4*i]);
+        }
+
+        order.resize(rooms);
+        for (int i = 0; i < rooms; i++)
+            order[i] = i;
+        LeftLess less = {this};
+        sort(order.begin(), order.end(), less);
+
+        overlaps = 0;
+        for (int b, a = 0; a < rooms; a++)
+        {
+            int i = order[a];
+            Rect& r1 = room[i].rect;
+            double right = max(r1.x1, r1.x2);
+
+            for (b = a+1; b < rooms && getLeft(order[b]) < right + reach; b++)
+            {
+                int j = order[b];
+                Rect& r2 = room[j].rect;
+                overlaps += getRoomIntersection(i, j);
+
+                double gap = max(min(r2.y1, r2.y2) - max(r1.y1, r1.y2), min(r1.y1, r1.y2) - max(r2.y1, r2.y2));
+                if (gap >= reach)
+                    continue;
+
+                Neighbor n = {j, getSharedWall(r1, r2), getAccessDistance(r1, r2)};
+                graph[i].push_back(n);
+                n.room = i;
+                graph[j].push_back(n);
+            }
+        }
+    }
+
+    void updateSpaceLinks()
+    {
+        const double doorWidth = 1;
+
+        spaceLinks.resize(rooms);
+        for (int j, i = 0; i < rooms; i++)
+        {
+            Neighbor& link = spaceLinks[i];
+            link.room = -1; link.wall = 0; link.distance = 10000;
+
+            for (j = 0; j < spaces.size(); j++)
+            {
+                link.distance = min(link.distance, getAccessDistance(room[i].rect, spaces[j]));
+                link.wall = max(link.wall, getSharedWall(room[i].rect, spaces[j]));
+                if (link.distance < 0.01 && link.wall >= doorWidth) break;
+            }
+        }
+    }
+
+    // link of two rooms, -1 for access space
+    Neighbor getLink(int from, int to)
+    {
+        if (from < 0) return spaceLinks[to];
+        if (to < 0) return spaceLinks[from];
+
+        for (size_t i = 0; i < graph[from].size(); i++)
+            if (graph[from][i].room == to)
+                return graph[from][i];
+
+        Neighbor far = {to, 0, getAccessDistance(room[from].rect, room[to].rect)};
+        return far;
     }
 
     vector<Rect> spaces;
+    vector<Point> points;
+
+    // probes per side of space detection: full fidelity grows with rooms,
+    // coarse webSize is a cheaper approximation of it
+    int fullWebSize() const
+    {
+        return max(12, int(4 * sqrt(double(rooms))));
+    }
+
+    int probes() const
+    {
+        return webSize > 0 ? min(webSize, fullWebSize()) : fullWebSize();
+    }
     void updateSpaces()
     {
+        TRACE_ZONE("updateSpaces");
+
         // points
-        static vector<Point> points;
 
 //        for (int i = 0; i < rooms; i++)
 //            addRectanglePoints(points, room[i].rect);
 
-        if (points.size() == 0)
+        const int size = probes();
+        if (points.size() != size_t(size * size))
         {
-            const int webSize = 12;
-            for (int j, i = 0; i < webSize; i++)
-                for (j = 0; j < webSize; j++)
-                    points.push_back(Point(space.getWidth()/(webSize+1) * (i+1), space.getHeight()/(webSize+1) * (j+1)));
+            points.clear();
+            for (int j, i = 0; i < size; i++)
+                for (j = 0; j < size; j++)
+                    points.push_back(Point(space.getWidth()/(size+1) * (i+1), space.getHeight()/(size+1) * (j+1)));
         }
 
-        // spaces
+        updateGrid();
+
+        // spaces, each of an empty point grown to walls of nearest rooms
+        // and shrunk out of rooms it overlaps
         vector<Rect> tmps;
         const double minSpaceLength = 1;
-        for (int j, i = 0; i < points.size(); i++)
+        for (int i = 0; i < points.size(); i++)
         if (isEmptyPoint(points[i]))
         {
-            double cleft = space.getWidth(), cright = 0, cup = space.getHeight(), cdown = 0;
-
-            Point& point = points[i];
-            for (j = 0; j < rooms; j++)
-            {
-                Rect& rect = room[j].rect;
-
-                if (point.y >= rect.y1 && point.y <= rect.y2)
-                {
-                    if (point.x <= rect.x1 && cleft - point.x > rect.x1 - point.x) cleft = rect.x1;
-                    if (point.x >= rect.x2 && point.x - cright > point.x - rect.x2) cright = rect.x2;
-                }
-
-                if (point.x >= rect.x1 && point.x <= rect.x2)
-                {
-                    if (point.y <= rect.y1 && cup - point.y > rect.y1 - point.y) cup = rect.y1;
-                    if (point.y >= rect.y2 && point.y - cdown > point.y - rect.y2) cdown = rect.y2;
-                }
-            }
-
-            Rect r(cright, cdown, cleft, cup);
+            Rect r;
+            getWalls(points[i], r);
             emptyRect(r);
 
-            if (r.getWidth() > minSpaceLength &&  r.getHeight() > minSpaceLength && ! findRect(tmps, r))
+            if (r.getWidth() > minSpaceLength &&  r.getHeight() > minSpaceLength && ! findSpace(tmps, r))
+            {
                 tmps.push_back(r);
+                addSpace(tmps.size() - 1, r);
+            }
         }
 
         // find biggest space
@@ -248,45 +483,193 @@ public:
 
         // find access spaces
         spaces.clear();
-        if (tmps.size() == 0) return;
+        if (tmps.size() > 0)
+        {
+            spaces.push_back(tmps[fittest]);
+            for (int i = 0; i < tmps.size(); i++)
+            if (i != fittest)
+                if (spaces[0].getIntersectionArea(tmps[i]) > 0)
+                    spaces.push_back(tmps[i]);
+        }
 
-        spaces.push_back(tmps[fittest]);
-        for (int i = 0; i < tmps.size(); i++)
-        if (i != fittest)
-            if (spaces[0].getIntersectionArea(tmps[i]) > 0)
-                spaces.push_back(tmps[i]);
+        updateSpaceLinks();
     }
 
 
     // Geometry funcitons
 
+    // Rooms and spaces by cells of a uniform grid over space, a few rooms
+    // per cell, so queries of a point or rect look at rooms around it only.
+    // Rooms out of space are in border cells.
+    int gridSize;
+    vector< vector<int> > grid, spaceGrid;
+    vector<int> marks, candidates; // rooms of a query
+    int mark;
+
+    inline double gridCoord(double v, double length)
+    {
+        return v / length * gridSize;
+    }
+    inline int gridCell(double v, double length)
+    {
+        int cell = int(gridCoord(v, length));
+        return cell < 0 ? 0 : (cell >= gridSize ? gridSize - 1 : cell);
+    }
+    void updateGrid()
+    {
+        gridSize = max(1, int(sqrt(rooms / 4.0)));
+        grid.resize(gridSize * gridSize);
+        spaceGrid.resize(gridSize * gridSize);
+        for (int i = 0; i < grid.size(); i++)
+        {
+            grid[i].clear();
+            spaceGrid[i].clear();
+        }
+        marks.assign(rooms, 0);
+        mark = 0;
+
+        double width = space.getWidth(), height = space.getHeight();
+        for (int x, y, i = 0; i < rooms; i++)
+        {
+            Rect& r = room[i].rect;
+            int x1 = gridCell(min(r.x1, r.x2), width), x2 = gridCell(max(r.x1, r.x2), width),
+                y1 = gridCell(min(r.y1, r.y2), height), y2 = gridCell(max(r.y1, r.y2), height);
+            for (y = y1; y <= y2; y++)
+                for (x = x1; x <= x2; x++)
+                    grid[y * gridSize + x].push_back(i);
+        }
+    }
+
     inline bool isEmptyPoint(Point& p)
     {
         if (! p.isInRect(space))
             return false;
 
-        for (int i = 0; i < rooms; i++)
-            if (p.isInRect(room[i].rect))
+        vector<int>& cell = grid[gridCell(p.y, space.getHeight()) * gridSize + gridCell(p.x, space.getWidth())];
+        for (int i = 0; i < cell.size(); i++)
+            if (p.isInRect(room[cell[i]].rect))
                 return false;
         return true;
     }
 
+    // walls of nearest rooms across row and column of point: rooms
+    // crossing its row left and right of it, crossing its column above and
+    // below it. Cells are walked outwards until rooms of farther cells can
+    // not be nearer than walls found.
+    inline void getWalls(Point& p, Rect& r)
+    {
+        double width = space.getWidth(), height = space.getHeight();
+        double left = 0, right = width, top = 0, bottom = height;
+        int cx = gridCell(p.x, width), cy = gridCell(p.y, height);
+
+        // cell of point, all four ways at once
+        vector<int>& own = grid[cy * gridSize + cx];
+        for (int i = 0; i < own.size(); i++)
+        {
+            Rect& rect = room[own[i]].rect;
+            if (p.y >= rect.y1 && p.y <= rect.y2)
+            {
+                if (p.x <= rect.x1 && rect.x1 < right) right = rect.x1;
+                if (p.x >= rect.x2 && rect.x2 > left) left = rect.x2;
+            }
+            if (p.x >= rect.x1 && p.x <= rect.x2)
+            {
+                if (p.y <= rect.y1 && rect.y1 < bottom) bottom = rect.y1;
+                if (p.y >= rect.y2 && rect.y2 > top) top = rect.y2;
+            }
+        }
+
+        for (int x = cx - 1; x >= 0 && gridCoord(left, width) < x + 1; x--)
+        {
+            vector<int>& cell = grid[cy * gridSize + x];
+            for (int i = 0; i < cell.size(); i++)
+            {
+                Rect& rect = room[cell[i]].rect;
+                if (p.y >= rect.y1 && p.y <= rect.y2 && p.x >= rect.x2 && rect.x2 > left) left = rect.x2;
+            }
+        }
+        for (int x = cx + 1; x < gridSize && gridCoord(right, width) >= x; x++)
+        {
+            vector<int>& cell = grid[cy * gridSize + x];
+            for (int i = 0; i < cell.size(); i++)
+            {
+                Rect& rect = room[cell[i]].rect;
+                if (p.y >= rect.y1 && p.y <= rect.y2 && p.x <= rect.x1 && rect.x1 < right) right = rect.x1;
+            }
+        }
+        for (int y = cy - 1; y >= 0 && gridCoord(top, height) < y + 1; y--)
+        {
+            vector<int>& cell = grid[y * gridSize + cx];
+            for (int i = 0; i < cell.size(); i++)
+            {
+                Rect& rect = room[cell[i]].rect;
+                if (p.x >= rect.x1 && p.x <= rect.x2 && p.y >= rect.y2 && rect.y2 > top) top = rect.y2;
+            }
+        }
+        for (int y = cy + 1; y < gridSize && gridCoord(bottom, height) >= y; y++)
+        {
+            vector<int>& cell = grid[y * gridSize + cx];
+            for (int i = 0; i < cell.size(); i++)
+            {
+                Rect& rect = room[cell[i]].rect;
+                if (p.x >= rect.x1 && p.x <= rect.x2 && p.y <= rect.y1 && rect.y1 < bottom) bottom = rect.y1;
+            }
+        }
+
+        r.set(left, top, right, bottom);
+    }
+
+    // rooms of cells a rect covers, once each, in order of rooms
+    const vector<int>& findCandidates(const Rect& r)
+    {
+        if (gridSize == 1)
+            return grid[0];
+
+        double width = space.getWidth(), height = space.getHeight();
+        int x1 = gridCell(min(r.x1, r.x2), width), x2 = gridCell(max(r.x1, r.x2), width),
+            y1 = gridCell(min(r.y1, r.y2), height), y2 = gridCell(max(r.y1, r.y2), height);
+
+        // rooms of a cell are in order already
+        if (x1 == x2 && y1 == y2)
+            return grid[y1 * gridSize + x1];
+
+        mark++;
+        candidates.clear();
+        for (int y = y1; y <= y2; y++)
+            for (int x = x1; x <= x2; x++)
+            {
+                vector<int>& cell = grid[y * gridSize + x];
+                for (int i = 0; i < cell.size(); i++)
+                    if (marks[cell[i]] != mark)
+                    {
+                        marks[cell[i]] = mark;
+                        candidates.push_back(cell[i]);
+                    }
+            }
+        sort(candidates.begin(), candidates.end());
+        return candidates;
+    }
+
     inline bool isEmptyRect(Rect& r)
     {
-        for (int i = 0; i < rooms; i++)
-            if (r.getIntersectionArea(room[i].rect) > 0)
+        const vector<int>& rooms = findCandidates(r);
+        for (int i = 0; i < rooms.size(); i++)
+            if (r.getIntersectionArea(room[rooms[i]].rect) > 0)
                 return false;
         return true;
     }
 
+    // rooms shrinking rect are those of its cells, as it only shrinks
     inline void emptyRect(Rect& r)
     {
+        const vector<int>& rooms = findCandidates(r);
+
         Rect r1, r2;
-        for (int i = 0; i < rooms; i++)
-            if (r.getIntersectionArea(room[i].rect) > 0)
+        for (int i = 0; i < rooms.size(); i++)
+            if (r.getIntersectionArea(room[rooms[i]].rect) > 0)
             {
                 r1 = r; r2 = r;
-                Rect& rm = room[i].rect;
+                Rect& rm = room[rooms[i]].rect;
                 if (r.x1 < rm.x1) r1.x2 = rm.x1; else r1.x1 = rm.x2;
                 if (r.y1 < rm.y1) r2.y2 = rm.y1; else r2.y1 = rm.y2;
 
@@ -294,6 +677,37 @@ public:
             }
     }
 
+    void addSpace(int index, const Rect& r)
+    {
+        if (gridSize == 1)
+            return;
+
+        double width = space.getWidth(), height = space.getHeight();
+        int x1 = gridCell(r.x1, width), x2 = gridCell(r.x2, width), y1 = gridCell(r.y1, height), y2 = gridCell(r.y2, height);
+        for (int y = y1; y <= y2; y++)
+            for (int x = x1; x <= x2; x++)
+                spaceGrid[y * gridSize + x].push_back(index);
+    }
+
+    // as findRect, for spaces bigger than tolerance of it, which overlap rect
+    bool findSpace(vector<Rect>& rects, Rect& rect)
+    {
+        if (gridSize == 1)
+            return findRect(rects, rect);
+
+        double width = space.getWidth(), height = space.getHeight();
+        int x1 = gridCell(rect.x1, width), x2 = gridCell(rect.x2, width), y1 = gridCell(rect.y1, height), y2 = gridCell(rect.y2, height);
+        for (int y = y1; y <= y2; y++)
+            for (int x = x1; x <= x2; x++)
+            {
+                vector<int>& cell = spaceGrid[y * gridSize + x];
+                for (int i = 0; i < cell.size(); i++)
+                    if (fabs(rect.getIntersectionArea(rects[cell[i]]) - rect.getArea()) < 1)
+                        return true;
+            }
+        return false;
+    }
+
     inline double getAlign(double r11, double r12, double r21, double r22)
     {
         const int offset = 1; // door width
@@ -320,20 +734,27 @@ public:
         return min(minX + yalign, minY + xalign);
     }
 
-    inline double* getSideDistances(const Rect& room)
+    // length of wall two rooms share, if they are not farther than a wall
+    inline double getSharedWall(const Rect& r1, const Rect& r2)
     {
-        double* d = new double[4]; // 0: up, 1: right, 2: down, 3: left
+        double xo = min(r1.x2, r2.x2) - max(r1.x1, r2.x1), yo = min(r1.y2, r2.y2) - max(r1.y1, r2.y1);
+        if (fabs(xo) <= wall && yo > 0) return yo;
+        if (fabs(yo) <= wall && xo > 0) return xo;
+        return 0;
+    }
+
+    inline void getSideDistances(const Rect& room, double* d)
+    {
+        // 0: up, 1: right, 2: down, 3: left
         d[0] = fabs(room.y1 - space.y1); d[1] = fabs(space.x2 - room.x2); d[2] = fabs(space.y2 - room.y2); d[3] = fabs(room.x1 - space.x1);
-        return d;
     }
 
     // Penalty functions
 
-    double getAreaPenalty()
+    double getRoomAreaPenalty(int i)
     {
         double penalty = 0;
 
-        for (int i = 0; i < rooms; i++)
         {
             if (room[i].sizeLimit.width)
             {
@@ -382,7 +803,7 @@ public:
             }
         }
 
-        return areaCoeff * penalty;
+        return penalty;
     }
 
 
@@ -407,37 +828,29 @@ public:
 
         return minX < 0 && minY < 0 ? min(fabs(minX), fabs(minY)) : 0;
     }
-    double getIntersectionPenalty()
+    inline double getLeft(int index)
     {
-        double penalty = 0;
-        for (int j, i = 0; i < rooms; i++)
-        {
-            penalty += house->getBoundaryIntersection(i);
-            for (j = i+1; j < house->rooms; j++)
-                penalty += house->getRoomIntersection(i, j);
-        }
-
-        return intersectionCoeff * penalty;
+        return min(room[index].rect.x1, room[index].rect.x2);
     }
 
-    double getSidePenalty()
-    {
-        double penalty = 0, *dists;
-        for (int i = 0; i < rooms; i++)
-        {
-            dists = getSideDistances(room[i].rect);
-            penalty += min(dists[0], dists[2]) + min(dists[1], dists[3]);
-        }
+    struct LeftLess {
+        House* house;
+        bool operator()(int a, int b) const { return house->getLeft(a) < house->getLeft(b); }
+    };
 
-        return sideCoeff * penalty;
+    vector<int> order; // rooms sorted by left side
+
+    double getRoomSidePenalty(int i)
+    {
+        const double* dists = &sides[4*i];
+        return min(dists[0], dists[2]) + min(dists[1], dists[3]);
     }
 
-    double getRoomLight(Rect& rect, int lightLimit)
+    double getRoomLight(Rect& rect, const double* dists, int lightLimit)
     {
         const double lightDistanceLimit = 0.5;
 
         double sum = 0;
-        double* dists = getSideDistances(rect);
         for (int i = 0; i < 4; i++)
             if (light[i] &&  dists[i] < lightDistanceLimit)
                 sum += lightLimit * light[i] * (!(i%2) ? rect.getWidth() : rect.getHeight());
@@ -448,32 +861,64 @@ public:
     {
         double profit = 0;
 
-        for (int j, i = 0; i < rooms; i++)
+        for (int i = 0; i < rooms; i++)
         if (room[i].lightLimit)
-            profit += getRoomLight(room[i].rect, 1);
+            profit += getRoomLight(room[i].rect, &sides[4*i], 1);
 
-        profit += getRoomLight(spaces[0], 2);
+        double dists[4];
+        getSideDistances(spaces[0], dists);
+        profit += getRoomLight(spaces[0], dists, 2);
 
         return lightCoeff * profit;
     }
 
+    vector<bool> reached; // by rooms, access space is last
+    vector< vector<int> > incident; // access edges of rooms, access space is last
+    vector<int> queue;
     double getAccessPenalty()
     {
+        const double doorWidth = 1;
+
+        // rooms reached from start through doors of access edges, others
+        // cost a door width, a search over edges with doors
+        incident.resize(rooms + 1);
+        for (size_t i = 0; i < incident.size(); i++)
+            incident[i].clear();
+
         double penalty = 0;
-        for (int j, i = 0; i < rooms; i++)
-            if (access[i] < 0) // from access space
+        for (size_t i = 0; i < edges.size(); i++)
+        {
+            Neighbor link = getLink(edges[i].from, edges[i].to);
+            penalty += link.distance;
+            if (link.wall >= doorWidth)
+            {
+                incident[edges[i].from < 0 ? rooms : edges[i].from].push_back(i);
+                incident[edges[i].to < 0 ? rooms : edges[i].to].push_back(i);
+            }
+        }
+
+        reached.assign(rooms + 1, false);
+        queue.assign(1, start < 0 ? rooms : start);
+        reached[queue[0]] = true;
+        for (size_t q = 0; q < queue.size(); q++)
+        {
+            vector<int>& links = incident[queue[q]];
+            for (size_t i = 0; i < links.size(); i++)
             {
-                double dist, min = 10000;
-                for (j = 0; j < spaces.size(); j++)
+                const AccessEdge& edge = edges[links[i]];
+                int from = edge.from < 0 ? rooms : edge.from, to = edge.to < 0 ? rooms : edge.to;
+                int other = from == queue[q] ? to : from;
+                if (! reached[other])
                 {
-                    dist = getAccessDistance(room[i].rect, spaces[j]);
-                    if (dist < min) min = dist;
-                    if (min < 0.01) break;
+                    reached[other] = true;
+                    queue.push_back(other);
                 }
-                penalty += min;
             }
-            else // from another room
-                penalty += getAccessDistance(room[i].rect, room[access[i]].rect);
+        }
+
+        for (int i = 0; i < rooms; i++)
+            if (! reached[i])
+                penalty += doorWidth;
 
         return accessCoeff * penalty;
     }
@@ -488,7 +933,7 @@ public:
         // maximize access spaces area
         profit += 2 * sqrt(spaces[0].getArea());
 
-        double intersection, area, sum;
+        double intersection, area, sum = 0;
         for (int i = 1; i < spaces.size(); i++)
         {
             intersection = spaces[0].getIntersectionArea(spaces[i]);
@@ -500,32 +945,74 @@ public:
 
         return spaceCoeff * profit;
     }
+
+    // all components of plan of last update
+    Evaluation evaluate()
+    {
+        Evaluation e = {0, 0, 0, 0, 0, 0, 0};
+
+        {
+            TRACE_ZONE("area");
+            TelemetryTimer timer(telemetry, Telemetry::Area);
+            double area = 0;
+            for (int i = 0; i < rooms; i++)
+                area += getRoomAreaPenalty(i);
+            e.area = areaCoeff * area;
+        }
+        {
+            TRACE_ZONE("intersection");
+            TelemetryTimer timer(telemetry, Telemetry::Intersection);
+            double intersection = overlaps;
+            for (int i = 0; i < rooms; i++)
+                intersection += getBoundaryIntersection(i);
+            e.intersection = intersectionCoeff * intersection;
+        }
+        {
+            TRACE_ZONE("side");
+            TelemetryTimer timer(telemetry, Telemetry::Side);
+            double side = 0;
+            for (int i = 0; i < rooms; i++)
+                side += getRoomSidePenalty(i);
+            e.side = sideCoeff * side;
+        }
+
+        { TelemetryTimer timer(telemetry, Telemetry::Spaces); updateSpaces(); }
+        if (spaces.size() > 0)
+        {
+            { TRACE_ZONE("space"); TelemetryTimer timer(telemetry, Telemetry::Space); e.space = getSpaceProfit(); }
+            { TRACE_ZONE("light"); TelemetryTimer timer(telemetry, Telemetry::Light); e.light = getLightProfit(); }
+            { TRACE_ZONE("access"); TelemetryTimer timer(telemetry, Telemetry::Access); e.access = getAccessPenalty(); }
+        }
+
+        e.total = e.area + e.side + e.intersection - e.space - e.light + e.access;
+        return e;
+    }
 };
 House* House::house = new House;
 
 
 // Evaluate
 
-double real_value(GENOME genome)
+Evaluation evaluate(House* house, GENOME genome)
 {
-    House* house = House::house;
-    house->update(genome);
+    TRACE_ZONE("real_value");
+    house->evaluations++;
 
-    double penalty = 0;
+    Telemetry* telemetry = house->telemetry;
+    if (telemetry) telemetry->evaluations++;
 
-    penalty += house->getAreaPenalty();
-    penalty += house->getSidePenalty();
-    penalty += house->getIntersectionPenalty();
+    { TelemetryTimer timer(telemetry, Telemetry::Update); house->update(genome); }
+    return house->evaluate();
+}
 
-    house->updateSpaces();
-    if (house->spaces.size() > 0)
-    {
-        penalty -= house->getSpaceProfit();
-        penalty -= house->getLightProfit();
-        penalty += house->getAccessPenalty();
-    }
+double real_value(House* house, GENOME genome)
+{
+    return evaluate(house, genome).total;
+}
 
-    return penalty;
+double real_value(GENOME genome)
+{
+    return real_value(House::house, genome);
 }
 
 #endif
@@ -0,0 +1,296 @@
+
+#ifndef FIDELITY_H
+#define FIDELITY_H
+
+// needs eo, evaluate.h, operators.h and breeder.h to be included before
+
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include "checkpoint.h"
+
+// Multi-fidelity space detection. For coarseGenerations, plans are
+// evaluated with a coarse grid of coarseWebSize probes per side, hill
+// climbing of mutations included, as it evaluates on same houses. A plan
+// whose coarse value is as good as elite-th best of last population is
+// evaluated again at full fidelity, so elites keep full values; in moeo
+// plans not dominated by archive are, so archive takes full values only.
+// Initial population and population at switch to full fidelity, or at end
+// of run, are evaluated at full fidelity.
+//
+// Cost model: each coarse generation, samples of population are evaluated
+// at both fidelities on a house of their own, for thread CPU time of each
+// and ranking error, share of sample pairs ordered otherwise by coarse
+// values. Saved time is coarse evaluations at difference of those times
+// less confirmations at full time, logged as a csv row.
+
+template <class EOT>
+class hadFidelityEval : public eoEvalFunc<EOT>, public hadHouseEval<EOT>
+{
+public:
+    typedef typename EOT::Fitness Fitness;
+
+    int coarseWebSize; // 0 at full fidelity
+    bool screening; // once promising plans are known
+    Fitness threshold; // elite-th best of last population
+    unsigned long coarseEvaluations, confirmations;
+
+    hadFidelityEval(hadHouseEval<EOT>& _eval, int _coarseWebSize, unsigned _elite = 1)
+        : coarseWebSize(_coarseWebSize), screening(false), threshold(Fitness()), coarseEvaluations(0), confirmations(0), eval(_eval), elite(max(_elite, 1u))
+    {
+        House::house->webSize = coarseWebSize;
+    }
+
+    void operator()(EOT& g)
+    {
+        (*this)(g, House::house);
+    }
+
+    bool operator()(EOT& g, House* house)
+    {
+        if (! coarseWebSize)
+            return eval(g, house);
+        if (! screening)
+            return full(g, house);
+
+        if (! eval(g, house))
+            return false;
+
+        #pragma omp atomic
+        coarseEvaluations++;
+
+        if (promising(g))
+        {
+            g.invalidate();
+            full(g, house);
+
+            #pragma omp atomic
+            confirmations++;
+        }
+        return true;
+    }
+
+    // plans of last generation to compare with
+    virtual void screen(const eoPop<EOT>& pop)
+    {
+        if (pop.empty())
+            return;
+
+        vector<Fitness> values;
+        for (size_t i = 0; i < pop.size(); i++)
+            values.push_back(pop[i].fitness());
+
+        size_t k = min<size_t>(elite, values.size()) - 1;
+        Better better;
+        nth_element(values.begin(), values.begin() + k, values.end(), better);
+        threshold = values[k];
+        screening = true;
+    }
+
+    string className() const { return "hadFidelityEval"; }
+
+protected:
+    virtual bool promising(const EOT& g)
+    {
+        return ! (g.fitness() < threshold);
+    }
+
+private:
+    hadHouseEval<EOT>& eval;
+    unsigned elite;
+
+    // EO fitness compares worse < better
+    struct Better {
+        bool operator()(const Fitness& a, const Fitness& b) const { return b < a; }
+    };
+
+    bool full(EOT& g, House* house)
+    {
+        int webSize = house->webSize;
+        house->webSize = 0;
+        bool evaluated = eval(g, house);
+        house->webSize = webSize;
+        return evaluated;
+    }
+};
+
+
+template <class EOT>
+class hadFidelitySchedule : public eoUpdater
+{
+public:
+    unsigned long generation;
+    double savedTime; // seconds, estimated
+    unsigned long evaluations, confirmations; // of fidelity at last generation
+
+    hadFidelitySchedule(eoPop<EOT>& _pop, hadFidelityEval<EOT>& _fidelity, eoEvalFunc<EOT>& _eval, unsigned _coarseGenerations, unsigned _samples)
+        : generation(0), savedTime(0), evaluations(0), confirmations(0), pop(_pop), fidelity(_fidelity), eval(_eval), coarseGenerations(_coarseGenerations), samples(_samples), probe(*House::house), file(0)
+    {
+        probe.telemetry = 0;
+    }
+
+    ~hadFidelitySchedule()
+    {
+        if (file) fclose(file);
+    }
+
+    // appends to rows of a resumed run
+    bool open(const char* filename, bool append = false)
+    {
+        file = fopen(filename, append ? "a" : "w");
+        if (! file) return false;
+
+        if (! append || ftell(file) == 0)
+            fprintf(file, "generation,webSize,coarseEvaluations,confirmations,coarseTime,fullTime,savedTime,rankError\n");
+        fflush(file);
+        return true;
+    }
+
+    void operator()()
+    {
+        TRACE_ZONE("fidelity");
+
+        if (! fidelity.coarseWebSize)
+            return;
+
+        measure();
+        if (++generation >= coarseGenerations)
+            refine();
+        else
+            fidelity.screen(pop);
+    }
+
+    // final population at full fidelity
+    void lastCall()
+    {
+        if (fidelity.coarseWebSize)
+            refine();
+    }
+
+    string className() const { return "hadFidelitySchedule"; }
+
+private:
+    eoPop<EOT>& pop;
+    hadFidelityEval<EOT>& fidelity;
+    eoEvalFunc<EOT>& eval;
+    unsigned coarseGenerations, samples;
+    House probe;
+    FILE* file;
+
+    static double now()
+    {
+        timespec t;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+        return t.tv_sec + 1e-9 * t.tv_nsec;
+    }
+
+    // plan value on probe house
+    double value(const EOT& g, int webSize, double& time)
+    {
+        vector<double> genome = genomeMetres(g);
+        probe.webSize = webSize;
+        double start = now();
+        probe.update(genome);
+        double total = probe.evaluate().total;
+        time += now() - start;
+        return total;
+    }
+
+    void measure()
+    {
+        size_t count = min<size_t>(samples, pop.size());
+        vector<double> coarse(count), full(count);
+        double coarseTime = 0, fullTime = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const EOT& g = pop[i * pop.size() / count];
+            coarse[i] = value(g, fidelity.coarseWebSize, coarseTime);
+            full[i] = value(g, 0, fullTime);
+        }
+
+        size_t pairs = 0, errors = 0;
+        for (size_t i = 0; i < count; i++)
+            for (size_t j = i+1; j < count; j++)
+                if (full[i] != full[j])
+                {
+                    pairs++;
+                    if ((coarse[i] < coarse[j]) != (full[i] < full[j]))
+                        errors++;
+                }
+
+        if (count)
+        {
+            coarseTime /= count;
+            fullTime /= count;
+        }
+        unsigned long coarseEvaluations = fidelity.coarseEvaluations - evaluations, fullEvaluations = fidelity.confirmations - confirmations;
+        evaluations = fidelity.coarseEvaluations;
+        confirmations = fidelity.confirmations;
+        savedTime += coarseEvaluations * (fullTime - coarseTime) - fullEvaluations * fullTime;
+
+        if (file)
+        {
+            probe.webSize = fidelity.coarseWebSize;
+            fprintf(file, "%lu,%d,%lu,%lu,%.6f,%.6f,%.3f,%.4f\n", generation, probe.probes(), coarseEvaluations, fullEvaluations, 1000 * coarseTime, 1000 * fullTime, savedTime, pairs ? double(errors) / pairs : 0);
+            fflush(file);
+        }
+    }
+
+    // rest of run at full fidelity
+    void refine()
+    {
+        TRACE_ZONE("refine");
+
+        fidelity.coarseWebSize = 0;
+        House::house->webSize = 0;
+        for (size_t i = 0; i < pop.size(); i++)
+        {
+            pop[i].invalidate();
+            eval(pop[i]);
+        }
+    }
+};
+
+// coarse fidelity of early generations, full fidelity for elites
+template <class EOT>
+hadFidelityEval<EOT>& do_make_fidelity_eval(eoParser& _parser, eoState& _state, hadHouseEval<EOT>& _eval)
+{
+    int coarseWebSize = _parser.createParam(0, "coarseWebSize", "Probes per side of space detection in early generations, 0 for full fidelity", '\0', "Evolution Engine").value();
+    unsigned elite = _parser.createParam(unsigned(5), "fidelityElite", "Plans as good as this best of population are evaluated at full fidelity", '\0', "Evolution Engine").value();
+
+    if (coarseWebSize < 0)
+        throw runtime_error("Coarse web size must not be negative");
+
+    hadFidelityEval<EOT>* fidelity = new hadFidelityEval<EOT>(_eval, coarseWebSize, elite);
+    _state.storeFunctor(fidelity);
+    return *fidelity;
+}
+
+// switch to full fidelity and cost model, log next to generation files
+template <class EOT>
+hadFidelitySchedule<EOT>& do_make_fidelity_schedule(eoParser& _parser, eoState& _state, eoPop<EOT>& _pop, hadFidelityEval<EOT>& _fidelity, eoEvalFunc<EOT>& _eval, hadRunState& _runState)
+{
+    unsigned coarseGenerations = _parser.createParam(unsigned(50), "coarseGenerations", "Generations at coarse fidelity of coarseWebSize", '\0', "Evolution Engine").value();
+    unsigned samples = _parser.createParam(unsigned(20), "fidelitySamples", "Plans of population evaluated at both fidelities for cost model", '\0', "Evolution Engine").value();
+    string resDir = _parser.getORcreateParam(string("Res"), "resDir", "Directory to store DISK outputs", '\0', "Output - Disk").value();
+
+    hadFidelitySchedule<EOT>* schedule = new hadFidelitySchedule<EOT>(_pop, _fidelity, _eval, coarseGenerations, samples);
+    _state.storeFunctor(schedule);
+    _runState.addValue("fidelityGeneration", schedule->generation);
+    _runState.addValue("fidelitySavedTime", schedule->savedTime);
+    _runState.addValue("fidelityScheduleEvaluations", schedule->evaluations);
+    _runState.addValue("fidelityScheduleConfirmations", schedule->confirmations);
+    _runState.addValue("fidelityWebSize", _fidelity.coarseWebSize);
+    _runState.addValue("fidelityScreening", _fidelity.screening);
+    _runState.addValue("fidelityThreshold", _fidelity.threshold);
+    _runState.addValue("fidelityEvaluations", _fidelity.coarseEvaluations);
+    _runState.addValue("fidelityConfirmations", _fidelity.confirmations);
+    House::house->webSize = _fidelity.coarseWebSize; // full after switch of resumed run
+    if (_fidelity.coarseWebSize)
+        schedule->open((resDir + "/fidelity.csv").c_str(), _runState.resumed());
+    return *schedule;
+}
+
+#endif
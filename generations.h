@@ -0,0 +1,98 @@
+#ifndef GENERATIONS_H
+#define GENERATIONS_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QtAlgorithms>
+
+#include <vector>
+using namespace std;
+
+#include "compress.h"
+
+// Generation files of engines, "generations#.sav" of EO or "generations#.savz"
+// of background writer, read by viewer and batch alike
+
+// filename: "generations#.sav" or "generations#.savz"
+inline int generationNumber(const QString& filename)
+{
+    int start = filename.indexOf("generations") + QString("generations").size();
+    return filename.mid(start, filename.lastIndexOf('.') - start).toInt();
+}
+
+struct FilenameLessThan {
+    bool operator()(const QString &s1, const QString &s2) const {
+        return generationNumber(s1) < generationNumber(s2);
+    }
+};
+
+// generation files of a directory in order of generations
+inline QStringList generationFiles(const QDir& dir)
+{
+    QStringList files;
+    QFileInfoList list = dir.entryInfoList();
+    for (int i = 0; i < list.size(); i++)
+        if (list.at(i).filePath().endsWith(".sav") || list.at(i).filePath().endsWith(".savz"))
+            files << list.at(i).filePath();
+
+    FilenameLessThan le;
+    qSort(files.begin(), files.end(), le);
+
+    // final state of a run may repeat its last generation
+    for (int i = files.count() - 1; i > 0; i--)
+        if (generationNumber(files[i]) == generationNumber(files[i-1]))
+            files.removeAt(i);
+
+    return files;
+}
+
+// individuals of eoPop section, a line each
+inline bool readGeneration(QString filename, QStringList& population)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // .savz files of background writer
+    QByteArray content = file.readAll();
+    if (isCompressed(content.constData(), content.size()))
+    {
+        string text;
+        if (! lzDecompress(content.constData(), content.size(), text))
+            return false;
+        content = QByteArray(text.data(), text.size());
+    }
+
+    population.clear();
+
+    QList<QByteArray> lines = content.split('\n');
+    for (int i = 0; i < lines.size(); i++)
+        if (lines[i].startsWith("\\section{eoPop}") && i+1 < lines.size())
+        {
+           int size = lines[++i].trimmed().toInt();
+
+           for (int j = 0; j < size && i+1 < lines.size(); j++)
+               population << QString(lines[++i]);
+        }
+
+    return true;
+}
+
+// genes of an individual line, after its fitness and genome size
+inline vector<double> getGenome(QString g, int size)
+{
+    vector<double> genome;
+    QStringList values = g.trimmed().split(" ");
+
+    int i = 0;
+    for (; i < values.size() && values[i].toDouble() != size; i++);
+    for (int j = i+1; (j < values.size()) && (j - i <= size); j++)
+        genome.push_back(values[j].toDouble());
+
+    return genome;
+}
+
+#endif
@@ -0,0 +1,44 @@
+
+#ifndef GENOME_H
+#define GENOME_H
+
+#include <stddef.h>
+#include <vector>
+using namespace std;
+
+// Genes of a plan in place, 4 per room: x, y, width, height. Views any
+// contiguous doubles, like EO and MOEO individuals or viewer genomes,
+// without copying them.
+
+class GenomeView {
+public:
+    GenomeView()
+        : genes(0), length(0)
+    {}
+
+    GenomeView(const double* _genes, size_t _length)
+        : genes(_genes), length(_length)
+    {}
+
+    GenomeView(const vector<double>& genome)
+        : genes(genome.empty() ? 0 : &genome[0]), length(genome.size())
+    {}
+
+    inline size_t size() const { return length; }
+    inline bool empty() const { return length == 0; }
+    inline const double& operator[](size_t i) const { return genes[i]; }
+    inline const double* data() const { return genes; }
+    inline const double* begin() const { return genes; }
+    inline const double* end() const { return genes + length; }
+
+    vector<double> toVector() const
+    {
+        return vector<double>(begin(), end());
+    }
+
+private:
+    const double* genes;
+    size_t length;
+};
+
+#endif
@@ -10,6 +10,9 @@ TARGET = had
 TEMPLATE = app
 TRANSLATIONS = had_fa.ts
 
+# trace zones, written to trace.json on exit
+# DEFINES += HAD_TRACE
+
 
 SOURCES += main.cpp\
     mainwindow.cpp \
@@ -17,6 +20,15 @@ SOURCES += main.cpp\
 
 HEADERS  += mainwindow.h \
     planviewer.h \
-    evaluate.h
+    evaluate.h \
+    localsearch.h \
+    history.h \
+    telemetry.h \
+    random.h \
+    json.h \
+    genome.h \
+    trace.h \
+    compress.h \
+    generations.h
 
 FORMS    += mainwindow.ui
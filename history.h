@@ -0,0 +1,243 @@
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <map>
+#include <vector>
+#include <string.h>
+#include <math.h>
+using namespace std;
+
+// Generations of a run kept in memory. Each generation is one byte stream
+// of its individuals, coded relative to the previous generation:
+//   0 (full):      value, all quantized genes
+//   1 (reference): index in previous generation, value
+//   2 (delta):     index in previous generation, value, changed genes as (gene, diff)
+// Every keyframe-th generation is coded full, so getting a generation decodes
+// at most keyframe generations.
+
+class History {
+public:
+    History(double _quantum = 0.001, int _keyframe = 64)
+        : quantum(_quantum), keyframe(_keyframe), cursor(-1)
+    {}
+
+    void clear()
+    {
+        generations.clear();
+        last.clear();
+        cursor = -1;
+    }
+
+    int size() const
+    {
+        return generations.size();
+    }
+
+    // drops generations from count on, to append them again
+    void truncate(int count)
+    {
+        if (count < 0 || count >= size())
+            return;
+
+        vector<double> values;
+        vector< vector<double> > genomes;
+        generations.resize(count);
+        cursor = -1;
+        last.clear();
+        if (count > 0 && get(count - 1, values, genomes))
+            last = cursorGenomes;
+    }
+
+    size_t memory() const
+    {
+        size_t bytes = 0;
+        for (size_t i = 0; i < generations.size(); i++)
+            bytes += generations[i].size();
+        return bytes;
+    }
+
+    void append(const vector<double>& values, const vector< vector<double> >& genomes)
+    {
+        vector< vector<int> > current(genomes.size());
+        for (size_t i = 0; i < genomes.size(); i++)
+            quantize(genomes[i], current[i]);
+
+        bool full = generations.size() % keyframe == 0;
+
+        map< vector<int>, int > previous;
+        if (! full)
+            for (size_t i = 0; i < last.size(); i++)
+                previous.insert(make_pair(last[i], i));
+
+        generations.push_back(vector<unsigned char>());
+        vector<unsigned char>& out = generations.back();
+        putUnsigned(out, genomes.size());
+
+        for (size_t i = 0; i < current.size(); i++)
+        {
+            vector<int>& genome = current[i];
+            map< vector<int>, int >::iterator found = previous.find(genome);
+
+            if (! full && found != previous.end())
+            {
+                putUnsigned(out, 1);
+                putUnsigned(out, found->second);
+                putFloat(out, values[i]);
+            }
+            else if (! full && i < last.size() && last[i].size() == genome.size())
+            {
+                putUnsigned(out, 2);
+                putUnsigned(out, i);
+                putFloat(out, values[i]);
+
+                size_t changes = 0;
+                for (size_t j = 0; j < genome.size(); j++)
+                    if (genome[j] != last[i][j]) changes++;
+
+                putUnsigned(out, changes);
+                for (size_t j = 0; j < genome.size(); j++)
+                    if (genome[j] != last[i][j])
+                    {
+                        putUnsigned(out, j);
+                        putSigned(out, genome[j] - last[i][j]);
+                    }
+            }
+            else
+            {
+                putUnsigned(out, 0);
+                putFloat(out, values[i]);
+                putUnsigned(out, genome.size());
+                for (size_t j = 0; j < genome.size(); j++)
+                    putSigned(out, genome[j]);
+            }
+        }
+
+        last.swap(current);
+    }
+
+    bool get(int generation, vector<double>& values, vector< vector<double> >& genomes)
+    {
+        if (generation < 0 || generation >= size())
+            return false;
+
+        // continue from last decoded generation if possible
+        if (cursor < 0 || generation < cursor || generation - cursor > generation % keyframe)
+            cursor = generation - generation % keyframe - 1;
+
+        for (cursor++; cursor <= generation; cursor++)
+            decode(generations[cursor], cursorGenomes, cursorValues);
+        cursor = generation;
+
+        values.assign(cursorValues.begin(), cursorValues.end());
+        genomes.resize(cursorGenomes.size());
+        for (size_t i = 0; i < cursorGenomes.size(); i++)
+        {
+            genomes[i].resize(cursorGenomes[i].size());
+            for (size_t j = 0; j < cursorGenomes[i].size(); j++)
+                genomes[i][j] = cursorGenomes[i][j] * quantum;
+        }
+
+        return true;
+    }
+
+private:
+    double quantum;
+    int keyframe;
+
+    vector< vector<unsigned char> > generations;
+    vector< vector<int> > last; // quantized genomes of last appended generation
+
+    int cursor; // last decoded generation
+    vector< vector<int> > cursorGenomes;
+    vector<float> cursorValues;
+
+    void quantize(const vector<double>& genome, vector<int>& q)
+    {
+        q.resize(genome.size());
+        for (size_t i = 0; i < genome.size(); i++)
+            q[i] = int(floor(genome[i] / quantum + 0.5));
+    }
+
+    void decode(const vector<unsigned char>& in, vector< vector<int> >& genomes, vector<float>& values)
+    {
+        size_t p = 0, count = getUnsigned(in, p);
+        vector< vector<int> > current(count);
+        values.resize(count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            int kind = getUnsigned(in, p);
+            if (kind == 0)
+            {
+                values[i] = getFloat(in, p);
+                current[i].resize(getUnsigned(in, p));
+                for (size_t j = 0; j < current[i].size(); j++)
+                    current[i][j] = getSigned(in, p);
+            }
+            else
+            {
+                current[i] = genomes[getUnsigned(in, p)];
+                values[i] = getFloat(in, p);
+
+                if (kind == 2)
+                    for (size_t j, changes = getUnsigned(in, p); changes > 0; changes--)
+                    {
+                        j = getUnsigned(in, p);
+                        current[i][j] += getSigned(in, p);
+                    }
+            }
+        }
+
+        genomes.swap(current);
+    }
+
+    // varint coding
+
+    static void putUnsigned(vector<unsigned char>& out, unsigned int v)
+    {
+        for (; v >= 0x80; v >>= 7)
+            out.push_back((v & 0x7f) | 0x80);
+        out.push_back(v);
+    }
+
+    static void putSigned(vector<unsigned char>& out, int v)
+    {
+        putUnsigned(out, ((unsigned int)v << 1) ^ (unsigned int)(v >> 31));
+    }
+
+    static void putFloat(vector<unsigned char>& out, float v)
+    {
+        unsigned char bytes[sizeof(float)];
+        memcpy(bytes, &v, sizeof(float));
+        out.insert(out.end(), bytes, bytes + sizeof(float));
+    }
+
+    static unsigned int getUnsigned(const vector<unsigned char>& in, size_t& p)
+    {
+        unsigned int v = 0;
+        for (int shift = 0; ; shift += 7)
+        {
+            unsigned char b = in[p++];
+            v |= (unsigned int)(b & 0x7f) << shift;
+            if (! (b & 0x80)) break;
+        }
+        return v;
+    }
+
+    static int getSigned(const vector<unsigned char>& in, size_t& p)
+    {
+        unsigned int v = getUnsigned(in, p);
+        return int(v >> 1) ^ -int(v & 1);
+    }
+
+    static float getFloat(const vector<unsigned char>& in, size_t& p)
+    {
+        float v;
+        memcpy(&v, &in[p], sizeof(float));
+        p += sizeof(float);
+        return v;
+    }
+};
+
+#endif
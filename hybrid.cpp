@@ -18,6 +18,12 @@
 using namespace std;
 
 #include "/home/alireza/repo/had/evaluate.h"
+#include "/home/alireza/repo/had/localsearch.h"
+#include "/home/alireza/repo/had/operators.h"
+#include "/home/alireza/repo/had/breeder.h"
+#include "/home/alireza/repo/had/saver.h"
+#include "/home/alireza/repo/had/diversity.h"
+#include "/home/alireza/repo/had/fidelity.h"
 
 #include <algo/moNeutralHC.h>
 
@@ -44,8 +50,6 @@ typedef eoReal<eoMinimizingFitness> HAD;
 #include <neighborhood/moBackableNeighbor.h>
 #include <neighborhood/moIndexNeighbor.h>
 
-const size_t neighbors = 20;
-
 struct Mem {
     int index;
     double diff;
@@ -59,17 +63,21 @@ public:
     using moIndexNeighbor<EOT>::key;
 
     Mem* mem;
+    RandomStream* stream;
 
     int kIndex;
     double kDiff;
 
     hadRealNeighbor()
+        : stream(&globalStream)
     {
         mem = new Mem[neighbors];
     }
 
     virtual void move(EOT& _solution)
     {
+        TRACE_ZONE("localSearchMove");
+
         // restart
         if (!key)
         {
@@ -82,6 +90,9 @@ public:
         _solution[kIndex] += kDiff;
         _solution.invalidate();
 
+        if (House::house->telemetry)
+            House::house->telemetry->localSearchSteps++;
+
 //        cout << key << "\t" << kIndex << "\t" << real_value(_solution) << "\t" << kDiff << endl;
     }
 
@@ -99,10 +110,9 @@ public:
         if (mem[key].index == -1) // move
         {
             const size_t size = 4 * House::house->rooms;
-            const double hcEpsilon = 0.5;
 
-            kIndex = size_t(size * rng.uniform());
-            kDiff = hcEpsilon * (rng.uniform() * 2 - 1);
+            kIndex = size_t(size * stream->uniform());
+            kDiff = hcEpsilon * (stream->uniform() * 2 - 1);
 
             mem[key].index = kIndex;
             mem[key].diff = kDiff;
@@ -121,77 +131,8 @@ typedef moOrderNeighborhood<hadNeighbor> orderNeighborhood;
 
 // Operators
 
-template<class GenotypeT>
-class RoomExchangeCrossover: public eoQuadOp<GenotypeT>
-{
-    const double pCrossExchange;
-
-public:
-    RoomExchangeCrossover(double _pExchange = 0.1)
-        : pCrossExchange(_pExchange)
-    {}
-
-    string className() const { return "RoomExchangeCrossover"; }
-
-    // modifies both parents
-    bool operator()(GenotypeT& g1, GenotypeT & g2)
-    {
-        bool oneAtLeastIsModified(false);
-
-        double tmp;
-        const size_t rooms = House::house->rooms;
-        for (size_t t, j, i = 0; i < rooms; i++)
-            if (rng.flip(pCrossExchange))
-            {
-                for (t = 4*i, j = 0; j < 4; j++)
-                {
-                    tmp = g1[t+j];
-                    g1[t+j] = g2[t+j];
-                    g2[t+j] = tmp;
-                }
-
-                if (!oneAtLeastIsModified) oneAtLeastIsModified = true;
-            }
-
-        return oneAtLeastIsModified;
-    }
-};
-
-template<class GenotypeT>
-class RoomSwapMutation: public eoMonOp<GenotypeT>
-{
-public:
-
-    string className() const { return "RoomSwapMutation"; }
-
-    // modifies parent
-    bool operator()(GenotypeT& g)
-    {
-        bool isModified(false);
-
-        const int rooms = House::house->rooms;
-        size_t first = rooms * rng.uniform(), second = rooms * rng.uniform();
-        first *= 4; second *= 4;
-
-        if (first != second)
-        {
-            double  x1 = g[second] + (g[second+2] - g[first+2]) / 2,
-                    y1 = g[second+1] + (g[second+3] - g[first+3]) / 2,
-                    x2 = g[first] + (g[first+2] - g[second+2]) / 2,
-                    y2 = g[first+1] + (g[first+3] - g[second+3]) / 2;
-
-            g[first] = x1; g[first+1] = y1;
-            g[second] = x2; g[second+1] = y2;
-
-            isModified = true;
-        }
-
-        return isModified;
-    }
-};
-
 template <class EOT>
-eoGenOp<EOT> & do_make_op(EOT, eoParser& parser, eoState& state)
+eoGenOp<EOT> & do_make_op(EOT, eoParser& parser, eoState& state, hadVariation<EOT>& variation, RepairMode repair)
 {
     double  pCross = parser.createParam(0.1, "pCross", "Crossover probability",'C',"Param").value(),
             pRoomExchangeCross = parser.createParam(0.1, "pRoomExchangeCross", "Room exchange probability in Crossover",'E',"Param").value(),
@@ -201,34 +142,56 @@ eoGenOp<EOT> & do_make_op(EOT, eoParser& parser, eoState& state)
             eUniformMut = parser.createParam(1, "eUniformMut", "epsilon for uniform mutation",'e',"Param").value(),
             pRoomSwapMut = parser.createParam(0.01, "pRoomSwapMut", "room swap mutation probability",'r',"Param").value(),
             pLocalSearchMut = parser.createParam(0.01, "pLocalSearchMut", "local search mutation probability",'l',"Param").value(),
-            maxLocalSearchStep = parser.createParam(50, "maxLocalSearchStep", "maximum steps of local search operator",'h',"Param").value();
+            maxLocalSearchStep = parser.createParam(50, "maxLocalSearchStep", "maximum steps of local search operator",'h',"Param").value(),
+            pTabuMut = parser.createParam(0.0, "pTabuMut", "tabu search mutation probability",'\0',"Param").value(),
+            maxTabuStep = parser.createParam(50, "maxTabuStep", "maximum steps of tabu search operator",'\0',"Param").value(),
+            tabuMoves = parser.createParam(20, "tabuMoves", "moves scored in each step of tabu search",'\0',"Param").value(),
+            tabuTenure = parser.createParam(7, "tabuTenure", "steps a reverse move stays tabu",'\0',"Param").value(),
+            tabuStep = parser.createParam(0.5, "tabuStep", "largest shift or resize of a room in tabu search",'\0',"Param").value();
 
     eoQuadOp<EOT> *ptQuad; // tmp
     eoPropCombinedQuadOp<EOT>* xover;
     state.storeFunctor(xover);
     eoPropCombinedMonOp<EOT>* mutation;
-    eoMonOp<EOT> *ptMon;
+    StreamMonOp<EOT> *ptMon;
     state.storeFunctor(mutation);
 
 
     // xover
-    ptQuad = new RoomExchangeCrossover<EOT>(pRoomExchangeCross);
-    xover = new eoPropCombinedQuadOp<EOT>(*ptQuad, 1); state.storeFunctor(ptQuad);
+    RoomExchangeCrossover<EOT>* roomExchange = new RoomExchangeCrossover<EOT>(pRoomExchangeCross);
+    xover = new eoPropCombinedQuadOp<EOT>(*roomExchange, 1); state.storeFunctor(roomExchange);
+    variation.xover = roomExchange;
+    variation.pCross = pCross;
+    variation.pMut = pMut;
 
 
     // mutation
-    ptMon = new eoUniformMutation<EOT>(eUniformMut);
+    ptMon = new UniformMutation<EOT>(eUniformMut);
     mutation = new eoPropCombinedMonOp<EOT>(*ptMon, pUniformMut); state.storeFunctor(ptMon);
+    variation.add(*ptMon, pUniformMut);
 
     ptMon = new RoomSwapMutation<EOT>;
     mutation->add(*ptMon, pRoomSwapMut); state.storeFunctor(ptMon);
+    variation.add(*ptMon, pRoomSwapMut);
 
     // hc
     hadEval<EOT>* fullEval = new hadEval<EOT>; state.storeFunctor(fullEval);
     moFullEvalByModif<hadNeighbor>* neighborEval = new moFullEvalByModif<hadNeighbor>(*fullEval); state.storeFunctor(neighborEval);
     orderNeighborhood* neighborhood = new orderNeighborhood(neighbors);
-    ptMon = new moNeutralHC<hadNeighbor>(*neighborhood, *fullEval, *neighborEval, maxLocalSearchStep);
-    mutation->add(*ptMon, pLocalSearchMut); state.storeFunctor(ptMon);
+    eoMonOp<EOT>* hc = new moNeutralHC<hadNeighbor>(*neighborhood, *fullEval, *neighborEval, maxLocalSearchStep);
+    mutation->add(*hc, pLocalSearchMut); state.storeFunctor(hc);
+
+    // same climbing on breeding tasks, as moNeutralHC evaluates on House::house
+    ptMon = new HillClimbingMutation<EOT>(maxLocalSearchStep);
+    variation.add(*ptMon, pLocalSearchMut); state.storeFunctor(ptMon);
+
+    // memetic tabu search
+    if (pTabuMut > 0)
+    {
+        ptMon = new TabuMutation<EOT>(maxTabuStep, tabuMoves, tabuTenure, tabuStep, repair);
+        mutation->add(*ptMon, pTabuMut); state.storeFunctor(ptMon);
+        variation.add(*ptMon, pTabuMut);
+    }
 
 
     // a proportional combination of a QuadCopy and crossover
@@ -282,22 +245,52 @@ void runAlgorithm(EOT, eoParser& _parser, eoState& _state)
     typedef typename EOT::Fitness FitT;
 
     // The evaluation fn - encapsulated into an eval counter for output
-    eoEvalFuncPtr<EOT, double, const std::vector<double>&> mainEval( real_value );
-    eoEvalFuncCounter<EOT> eval(mainEval);
+    RepairMode repair = do_make_repair(_parser);
+    hadScalarEval<EOT> mainEval(repair);
+    hadFidelityEval<EOT>& fidelityEval = do_make_fidelity_eval(_parser, _state, mainEval);
+    eoEvalFuncCounter<EOT> eval(fidelityEval);
 
+    do_make_problem(_parser);
+    hadRunState runState(_parser);
     eoRealInitBounded<EOT>& init = make_genotype(_parser, _state, EOT());
 
-    eoGenOp<EOT>& op = do_make_op(EOT(), _parser, _state);
+    hadVariation<EOT> variation;
+    eoGenOp<EOT>& op = do_make_op(EOT(), _parser, _state, variation, repair);
 
     // initialize the population - and evaluate
     eoPop<EOT>& pop = make_pop(_parser, _state, init);
+    runState.add("population", pop);
+    runState.add("rng", rng);
+    runState.addValue("evaluations", eval.value());
     apply<EOT>(eval, pop);
 
-    eoContinue<EOT> & term = make_continue(_parser, _state, eval);
+    eoContinue<EOT> & term = do_make_continue(_parser, _state, eval, runState);
+    hadAsyncSaver<EOT>* saver = do_make_async_saver(_parser, _state, pop, runState);
     eoCheckPoint<EOT> & checkpoint = make_checkpoint(_parser, _state, eval, term);
-    eoAlgo<EOT>& ga = do_make_algo_scalar(_parser, _state, eval, checkpoint, op);
+
+    // coarse fidelity of early generations, before population is saved
+    checkpoint.add(do_make_fidelity_schedule(_parser, _state, pop, fidelityEval, eval, runState));
+    if (saver) checkpoint.add(*saver);
+
+    // telemetry of run, next to generation files
+    string resDir = _parser.getORcreateParam(string("Res"), "resDir", "Directory to store DISK outputs", '\0', "Output - Disk").value();
+    hadTelemetryUpdater& telemetryUpdater = do_make_telemetry(_parser, _state, runState);
+    Telemetry& telemetry = telemetryUpdater.telemetry;
+
+    // spread of population, before telemetry row is closed
+    checkpoint.add(do_make_diversity(_parser, _state, pop, init, eval, &telemetry, runState));
+
+    checkpoint.add(telemetryUpdater);
+    // breed and evaluate offspring on all cores
+    bool parallel = _parser.createParam(false, "parallel", "Breed and evaluate offspring in parallel", '\0', "Evolution Engine").value();
+    eoAlgo<EOT>& ga = parallel ? do_make_algo_parallel(_parser, _state, eval, checkpoint, variation, fidelityEval, runState) : do_make_algo_scalar(_parser, _state, eval, checkpoint, do_make_op_serial(_parser, _state, eval, checkpoint, op, variation, runState));
+
+    // full state after all other updaters and continuators of generation
+    hadRunStateContinue<EOT> runStateContinue(runState);
+    checkpoint.add(runStateContinue);
 
     run_ea(ga, pop);
+    TRACE_WRITE((resDir + "/trace.json").c_str());
 
     make_help(_parser);
     // pop.sortedPrintOn(cout);
@@ -0,0 +1,439 @@
+
+#ifndef HYPERVOLUME_H
+#define HYPERVOLUME_H
+
+#include <pthread.h>
+#include <math.h>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+using namespace std;
+
+#include "random.h"
+#include "trace.h"
+
+// Hypervolume of minimized points, flat with dimension values per point,
+// up to a reference point. Points not better than reference in every
+// objective add nothing.
+
+
+// Exact, WFG (While et al. 2012)
+
+struct LastLess {
+    const vector<double>& points;
+    size_t dimension, objective;
+    bool operator()(int a, int b) const { return points[dimension * a + objective] > points[dimension * b + objective]; }
+};
+
+// points not weakly dominated by another, in first dimension objectives
+inline void nondominated(vector<double>& points, size_t stride, size_t dimension)
+{
+    size_t count = points.size() / stride, kept = 0;
+    vector<bool> dropped(count, false);
+
+    for (size_t i = 0; i < count; i++)
+        for (size_t j = 0; j < count && ! dropped[i]; j++)
+        {
+            if (i == j || dropped[j]) continue;
+
+            const double *a = &points[stride * j], *b = &points[stride * i];
+            size_t k = 0;
+            while (k < dimension && a[k] <= b[k]) k++;
+            if (k == dimension) dropped[i] = true;
+        }
+
+    for (size_t i = 0; i < count; i++)
+        if (! dropped[i])
+        {
+            copy(&points[stride * i], &points[stride * i] + stride, &points[stride * kept]);
+            kept++;
+        }
+    points.resize(stride * kept);
+}
+
+// points are kept in full stride, only first dimension objectives count
+inline double wfg(vector<double> points, size_t stride, size_t dimension, const double* reference)
+{
+    size_t count = points.size() / stride;
+    if (count == 0)
+        return 0;
+
+    if (count == 1 || dimension == 1)
+    {
+        double volume = 0, box;
+        for (size_t i = 0; i < count; i++)
+        {
+            box = 1;
+            for (size_t k = 0; k < dimension; k++)
+                box *= reference[k] - points[stride * i + k];
+            volume = max(volume, box);
+        }
+        return volume;
+    }
+
+    vector<int> order(count);
+    for (size_t i = 0; i < count; i++)
+        order[i] = i;
+    LastLess less = {points, stride, dimension - 1};
+    sort(order.begin(), order.end(), less);
+
+    if (dimension == 2)
+    {
+        // sweep from best to worst second objective, each point adds its
+        // strip left of points before it
+        double volume = 0, right = reference[0];
+        for (size_t i = count; i-- > 0; )
+        {
+            const double* p = &points[stride * order[i]];
+            if (p[0] < right)
+            {
+                volume += (right - p[0]) * (reference[1] - p[1]);
+                right = p[0];
+            }
+        }
+        return volume;
+    }
+
+    // slices of last objective: later points are better in it, so their
+    // limits with k-th point all share its last objective
+    double volume = 0, box;
+    vector<double> limits;
+    for (size_t k = 0; k < count; k++)
+    {
+        const double* p = &points[stride * order[k]];
+
+        limits.clear();
+        for (size_t j = k+1; j < count; j++)
+        {
+            const double* q = &points[stride * order[j]];
+            for (size_t i = 0; i < dimension - 1; i++)
+                limits.push_back(max(p[i], q[i]));
+        }
+        nondominated(limits, dimension - 1, dimension - 1);
+
+        box = 1;
+        for (size_t i = 0; i < dimension - 1; i++)
+            box *= reference[i] - p[i];
+
+        volume += (reference[dimension - 1] - p[dimension - 1]) * (box - wfg(limits, dimension - 1, dimension - 1, reference));
+    }
+    return volume;
+}
+
+// points beyond reference are dropped
+inline vector<double> clipped(const vector<double>& points, size_t dimension, const double* reference)
+{
+    vector<double> inside;
+    for (size_t i = 0; i + dimension <= points.size(); i += dimension)
+    {
+        size_t k = 0;
+        while (k < dimension && points[i + k] < reference[k]) k++;
+        if (k == dimension)
+            inside.insert(inside.end(), points.begin() + i, points.begin() + i + dimension);
+    }
+    return inside;
+}
+
+inline double hypervolume(const vector<double>& points, size_t dimension, const double* reference)
+{
+    vector<double> inside = clipped(points, dimension, reference);
+    nondominated(inside, dimension, dimension);
+    return wfg(inside, dimension, dimension, reference);
+}
+
+// volume only point adds to points
+inline double exclusiveHypervolume(const double* point, const vector<double>& points, size_t dimension, const double* reference)
+{
+    vector<double> limits;
+    for (size_t i = 0; i + dimension <= points.size(); i += dimension)
+        for (size_t k = 0; k < dimension; k++)
+            limits.push_back(max(point[k], points[i + k]));
+
+    double box = 1;
+    for (size_t k = 0; k < dimension; k++)
+        box *= max(0.0, reference[k] - point[k]);
+
+    return box - hypervolume(limits, dimension, reference);
+}
+
+
+// Monte Carlo, uniform samples in box of points and reference, error is
+// half width of 95% confidence interval
+
+inline double sampledHypervolume(const vector<double>& points, size_t dimension, const double* reference, size_t samples, RandomStream& random, double& error)
+{
+    vector<double> inside = clipped(points, dimension, reference);
+    nondominated(inside, dimension, dimension);
+    error = 0;
+    if (inside.empty() || samples == 0)
+        return 0;
+
+    vector<double> low(reference, reference + dimension);
+    for (size_t i = 0; i < inside.size(); i += dimension)
+        for (size_t k = 0; k < dimension; k++)
+            low[k] = min(low[k], inside[i + k]);
+
+    double box = 1;
+    for (size_t k = 0; k < dimension; k++)
+        box *= reference[k] - low[k];
+
+    vector<double> sample(dimension);
+    size_t hits = 0;
+    for (size_t s = 0; s < samples; s++)
+    {
+        for (size_t k = 0; k < dimension; k++)
+            sample[k] = low[k] + random.uniform() * (reference[k] - low[k]);
+
+        for (size_t i = 0; i < inside.size(); i += dimension)
+        {
+            size_t k = 0;
+            while (k < dimension && inside[i + k] <= sample[k]) k++;
+            if (k == dimension) { hits++; break; }
+        }
+    }
+
+    double p = double(hits) / samples;
+    error = 1.96 * box * sqrt(p * (1 - p) / samples);
+    return box * p;
+}
+
+
+// Background
+
+// Hypervolume of fronts of a run on a thread of its own, so generations do
+// not wait for it. A submitted front replaces one still waiting. Objectives
+// are normalized by ideal and nadir of first front, reference is 1.1 of that
+// nadir, so values of a run are comparable. Exact values are updated by
+// exclusive volumes of added points while removed points are dominated by
+// added ones, otherwise recomputed. Thread starts with first front.
+
+class HypervolumeMonitor {
+public:
+    HypervolumeMonitor(size_t _samples = 0, uint32_t _seed = 0)
+        : samples(_samples), dimension(0), seed(_seed), waiting(false), busy(false), stopped(false), started(false), generation(-1), value(0), error(0), volume(0), computed(-1)
+    {
+        pthread_mutex_init(&mutex, 0);
+        pthread_cond_init(&changed, 0);
+    }
+
+    ~HypervolumeMonitor()
+    {
+        pthread_mutex_lock(&mutex);
+        stopped = true;
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&mutex);
+
+        if (started)
+            pthread_join(thread, 0);
+        pthread_cond_destroy(&changed);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    // costs of front, dimension values per point
+    void submit(int _generation, const vector<double>& costs, size_t _dimension)
+    {
+        pthread_mutex_lock(&mutex);
+        if (! started)
+        {
+            pthread_create(&thread, 0, run, this);
+            started = true;
+        }
+        next = costs;
+        nextGeneration = _generation;
+        dimension = _dimension;
+        waiting = true;
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    // last computed value, false if there is none
+    bool latest(int& _generation, double& _value, double& _error)
+    {
+        pthread_mutex_lock(&mutex);
+        _generation = generation; _value = value; _error = error;
+        pthread_mutex_unlock(&mutex);
+        return _generation >= 0;
+    }
+
+    // latest value, normalization and front of run, once submitted fronts
+    // are computed
+    void printOn(ostream& os)
+    {
+        pthread_mutex_lock(&mutex);
+        while (waiting || busy)
+            pthread_cond_wait(&changed, &mutex);
+
+        os << dimension << ' ' << generation << ' ' << value << ' ' << error << ' ' << computed << ' ' << volume;
+        print(os, ideal);
+        print(os, scale);
+        print(os, front);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    // before first front of resumed run
+    void readFrom(istream& is)
+    {
+        pthread_mutex_lock(&mutex);
+        is >> dimension >> generation >> value >> error >> computed >> volume;
+        read(is, ideal);
+        read(is, scale);
+        read(is, front);
+        pthread_mutex_unlock(&mutex);
+    }
+
+private:
+    size_t samples, dimension;
+    uint32_t seed;
+
+    // shared
+    vector<double> next;
+    int nextGeneration;
+    bool waiting, busy, stopped, started;
+    int generation;
+    double value, error;
+
+    // of thread
+    vector<double> ideal, scale, front;
+    double volume;
+    int computed;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+
+    static void* run(void* monitor)
+    {
+        ((HypervolumeMonitor*) monitor)->work();
+        return 0;
+    }
+
+    void work()
+    {
+        vector<double> costs;
+        for (;;)
+        {
+            pthread_mutex_lock(&mutex);
+            while (! waiting && ! stopped)
+                pthread_cond_wait(&changed, &mutex);
+            if (stopped)
+            {
+                pthread_mutex_unlock(&mutex);
+                return;
+            }
+            costs.swap(next);
+            int current = nextGeneration;
+            waiting = false;
+            busy = true;
+            pthread_mutex_unlock(&mutex);
+
+            double currentError = 0, currentValue = compute(costs, current, currentError);
+
+            pthread_mutex_lock(&mutex);
+            generation = current; value = currentValue; error = currentError;
+            busy = false;
+            pthread_cond_broadcast(&changed);
+            pthread_mutex_unlock(&mutex);
+        }
+    }
+
+    double compute(const vector<double>& costs, int current, double& currentError)
+    {
+        TRACE_ZONE("hypervolume");
+
+        if (scale.empty())
+        {
+            ideal.assign(dimension, 0);
+            scale.assign(dimension, 0);
+            for (size_t k = 0; k < dimension; k++)
+            {
+                double low = costs[k], high = costs[k];
+                for (size_t i = k; i < costs.size(); i += dimension)
+                {
+                    low = min(low, costs[i]);
+                    high = max(high, costs[i]);
+                }
+                ideal[k] = low;
+                scale[k] = high > low ? high - low : 1;
+            }
+        }
+
+        vector<double> points(costs.size());
+        for (size_t i = 0; i < costs.size(); i++)
+            points[i] = (costs[i] - ideal[i % dimension]) / scale[i % dimension];
+        vector<double> one(dimension, 1.1);
+
+        if (samples)
+        {
+            PhiloxStream random(seed, current);
+            return sampledHypervolume(points, dimension, &one[0], samples, random, currentError);
+        }
+
+        vector<double> inside = clipped(points, dimension, &one[0]);
+        nondominated(inside, dimension, dimension);
+
+        if (computed < 0 || ! update(inside, &one[0]))
+            volume = wfg(inside, dimension, dimension, &one[0]);
+        front.swap(inside);
+        computed = current;
+        return volume;
+    }
+
+    // adds exclusive volumes of new points of front, false if a point of
+    // previous front left without being dominated
+    bool update(const vector<double>& inside, const double* one)
+    {
+        vector<double> added;
+        for (size_t i = 0; i < inside.size(); i += dimension)
+            if (! contains(front, &inside[i]))
+                added.insert(added.end(), inside.begin() + i, inside.begin() + i + dimension);
+
+        for (size_t i = 0; i < front.size(); i += dimension)
+            if (! contains(inside, &front[i]) && ! covered(added, &front[i]))
+                return false;
+
+        vector<double> points = front;
+        for (size_t i = 0; i < added.size(); i += dimension)
+        {
+            volume += exclusiveHypervolume(&added[i], points, dimension, one);
+            points.insert(points.end(), added.begin() + i, added.begin() + i + dimension);
+        }
+        return true;
+    }
+
+    bool contains(const vector<double>& points, const double* point) const
+    {
+        for (size_t i = 0; i < points.size(); i += dimension)
+            if (equal(point, point + dimension, points.begin() + i))
+                return true;
+        return false;
+    }
+
+    static void print(ostream& os, const vector<double>& values)
+    {
+        os << ' ' << values.size();
+        for (size_t i = 0; i < values.size(); i++)
+            os << ' ' << values[i];
+    }
+
+    static void read(istream& is, vector<double>& values)
+    {
+        size_t size = 0;
+        is >> size;
+        values.resize(size);
+        for (size_t i = 0; i < size; i++)
+            is >> values[i];
+    }
+
+    bool covered(const vector<double>& points, const double* point) const
+    {
+        for (size_t i = 0; i < points.size(); i += dimension)
+        {
+            size_t k = 0;
+            while (k < dimension && points[i + k] <= point[k]) k++;
+            if (k == dimension) return true;
+        }
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,242 @@
+
+#ifndef INDICATOR_H
+#define INDICATOR_H
+
+// needs moeo to be included before
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "trace.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// IBEA fitness of moeoExpBinaryIndicatorBasedFitnessAssignment with additive
+// epsilon indicator, fitness of b is sum of -exp(-I(a, b) / kappa) over other
+// individuals a. Objectives are normalized by bounds of population into a
+// flat array, then terms of each pair are computed in square tiles of tileSize
+// individuals, whose vectors stay in cache, as independent tasks on all
+// threads. Terms are kept, so removal of an individual adds back its row of
+// terms instead of computing indicators again. Sums are taken in order of
+// individuals, so fitness values do not depend on number of threads and are
+// same as of moeoIBEA.
+
+template <class MOEOT>
+class hadIndicatorFitnessAssignment : public moeoBinaryIndicatorBasedFitnessAssignment<MOEOT>
+{
+public:
+    typedef typename MOEOT::ObjectiveVector ObjectiveVector;
+
+    hadIndicatorFitnessAssignment(double _kappa = 0.05)
+        : kappa(_kappa), dimension(ObjectiveVector::nObjectives()), count(0)
+    {}
+
+    void operator()(eoPop<MOEOT>& pop)
+    {
+        TRACE_ZONE("indicatorFitness");
+
+        setup(pop);
+        computeTerms();
+
+        // column sums, each thread over its own columns in order of rows
+        vector<double> fitness(count, 0.0);
+        #pragma omp parallel
+        {
+            int threads = 1, thread = 0;
+#ifdef _OPENMP
+            threads = omp_get_num_threads();
+            thread = omp_get_thread_num();
+#endif
+            size_t first = count * thread / threads, last = count * (thread + 1) / threads;
+            for (size_t a = 0; a < count; a++)
+            {
+                const double* row = &terms[count * a];
+                for (size_t b = first; b < last; b++)
+                    if (a != b)
+                        fitness[b] -= row[b];
+            }
+        }
+
+        for (size_t b = 0; b < count; b++)
+            pop[b].fitness(fitness[b]);
+    }
+
+    // individual at index of assigned population is removed, its indicators
+    // are no longer counted in fitness of others
+    void remove(eoPop<MOEOT>& pop, size_t index, const vector<bool>& removed)
+    {
+        const double* row = &terms[count * index];
+        for (size_t b = 0; b < count; b++)
+            if (! removed[b])
+                pop[b].fitness(pop[b].fitness() + row[b]);
+    }
+
+    // for replacements that erase from population, terms are computed again
+    void updateByDeleting(eoPop<MOEOT>& pop, ObjectiveVector& objectiveVector)
+    {
+        vector<double> p = normalized(objectiveVector);
+        for (size_t b = 0; b < pop.size(); b++)
+        {
+            vector<double> q = normalized(pop[b].objectiveVector());
+            pop[b].fitness(pop[b].fitness() + exp(-epsilon(&p[0], &q[0]) / kappa));
+        }
+        count = 0;
+    }
+
+    double updateByAdding(eoPop<MOEOT>& pop, ObjectiveVector& objectiveVector)
+    {
+        vector<double> p = normalized(objectiveVector);
+        double fitness = 0;
+        for (size_t b = 0; b < pop.size(); b++)
+        {
+            vector<double> q = normalized(pop[b].objectiveVector());
+            pop[b].fitness(pop[b].fitness() - exp(-epsilon(&p[0], &q[0]) / kappa));
+            fitness -= exp(-epsilon(&q[0], &p[0]) / kappa);
+        }
+        count = 0;
+        return fitness;
+    }
+
+private:
+    static const size_t tileSize = 64;
+
+    double kappa;
+    size_t dimension, count;
+    vector<double> lower, range;
+    vector<double> costs; // normalized, dimension values per individual
+    vector<double> terms; // exp(-I(a, b) / kappa) at count * a + b
+
+    // bounds as of moeoNormalizedSolutionVsSolutionBinaryMetric
+    void setup(const eoPop<MOEOT>& pop)
+    {
+        count = pop.size();
+        lower.assign(dimension, 0);
+        range.assign(dimension, 1);
+        for (size_t k = 0; k < dimension && count; k++)
+        {
+            double low = pop[0].objectiveVector()[k], high = low;
+            for (size_t i = 1; i < count; i++)
+            {
+                low = min(low, pop[i].objectiveVector()[k]);
+                high = max(high, pop[i].objectiveVector()[k]);
+            }
+            if (low == high)
+            {
+                low -= 1e-6;
+                high += 1e-6;
+            }
+            lower[k] = low;
+            range[k] = high - low;
+        }
+
+        costs.resize(count * dimension);
+        for (size_t i = 0; i < count; i++)
+        {
+            vector<double> p = normalized(pop[i].objectiveVector());
+            copy(p.begin(), p.end(), costs.begin() + dimension * i);
+        }
+    }
+
+    // maximized objectives are negated, so all are costs
+    vector<double> normalized(const ObjectiveVector& objectiveVector) const
+    {
+        vector<double> p(dimension);
+        for (size_t k = 0; k < dimension; k++)
+        {
+            p[k] = (objectiveVector[k] - lower[k]) / range[k];
+            if (! ObjectiveVector::minimizing(k))
+                p[k] = -p[k];
+        }
+        return p;
+    }
+
+    // additive epsilon of a over b
+    double epsilon(const double* a, const double* b) const
+    {
+        double e = a[0] - b[0];
+        for (size_t k = 1; k < dimension; k++)
+            e = max(e, a[k] - b[k]);
+        return e;
+    }
+
+    void computeTerms()
+    {
+        terms.resize(count * count);
+        int tiles = (count + tileSize - 1) / tileSize;
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int t = 0; t < tiles * tiles; t++)
+        {
+            size_t rows = tileSize * (t / tiles), columns = tileSize * (t % tiles);
+            size_t lastRow = min(rows + tileSize, count), lastColumn = min(columns + tileSize, count);
+
+            for (size_t a = rows; a < lastRow; a++)
+            {
+                const double* p = &costs[dimension * a];
+                double* row = &terms[count * a];
+                for (size_t b = columns; b < lastColumn; b++)
+                    row[b] = a == b ? 0 : exp(-epsilon(p, &costs[dimension * b]) / kappa);
+            }
+        }
+    }
+};
+
+
+// moeoEnvironmentalReplacement for hadIndicatorFitnessAssignment: worst
+// individuals are marked removed and their terms taken back one by one, then
+// population is compacted once, in order. Diversity is assigned once, as
+// IBEA keeps dummy diversity.
+
+template <class MOEOT>
+class hadIndicatorReplacement : public moeoReplacement<MOEOT>
+{
+public:
+    hadIndicatorReplacement(hadIndicatorFitnessAssignment<MOEOT>& _fitnessAssignment, moeoDiversityAssignment<MOEOT>& _diversityAssignment)
+        : fitnessAssignment(_fitnessAssignment), diversityAssignment(_diversityAssignment)
+    {}
+
+    void operator()(eoPop<MOEOT>& parents, eoPop<MOEOT>& offspring)
+    {
+        TRACE_ZONE("indicatorReplace");
+
+        size_t size = parents.size();
+        parents.reserve(parents.size() + offspring.size());
+        copy(offspring.begin(), offspring.end(), back_inserter(parents));
+        fitnessAssignment(parents);
+        diversityAssignment(parents);
+
+        // first of worst, as min_element
+        vector<bool> removed(parents.size(), false);
+        for (size_t left = parents.size(); left > size; left--)
+        {
+            size_t worst = parents.size();
+            for (size_t i = 0; i < parents.size(); i++)
+                if (! removed[i] && (worst == parents.size() || comparator(parents[i], parents[worst])))
+                    worst = i;
+
+            removed[worst] = true;
+            fitnessAssignment.remove(parents, worst, removed);
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < parents.size(); i++)
+            if (! removed[i])
+            {
+                if (kept != i)
+                    swap(parents[kept], parents[i]);
+                kept++;
+            }
+        parents.resize(kept);
+        offspring.clear();
+    }
+
+private:
+    hadIndicatorFitnessAssignment<MOEOT>& fitnessAssignment;
+    moeoDiversityAssignment<MOEOT>& diversityAssignment;
+    moeoFitnessThenDiversityComparator<MOEOT> comparator;
+};
+
+#endif
@@ -0,0 +1,158 @@
+
+#ifndef INSTANCES_H
+#define INSTANCES_H
+
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include "random.h"
+
+// Problem instances of a benchmark suite, as problem.json. An instance
+// depends only on its seed and number of rooms, access space excluded: a
+// plot of about instanceArea square metres per room with random aspect,
+// walls of instanceWall and instanceOutWall at 5 rooms, thicker by half at
+// 200 as of a larger building, light on random sides, a stairs and
+// elevator core per 40 rooms, rest of rooms drawn from instanceKinds with
+// their shares and light needs, and an access tree where a room is entered
+// from access space, the core or a room drawn before it.
+
+const double instanceArea = 14;
+const double instanceWall = 0.15, instanceOutWall = 0.3;
+
+struct InstanceKind {
+    const char* name;
+    int share, light;
+    bool inner; // entered from another room of its unit
+};
+
+const InstanceKind instanceKinds[] = {
+    {"bedroom", 4, 1, false},
+    {"kitchen", 4, 1, false},
+    {"office", 3, 1, false},
+    {"bathroom", 1, 0, true},
+    {"toilet", 1, 0, false},
+    {"storage", 2, 0, true},
+    {"dining", 5, 1, false},
+};
+const int instanceKindCount = sizeof(instanceKinds) / sizeof(instanceKinds[0]);
+
+inline string instanceName(uint32_t seed, int rooms)
+{
+    char name[32];
+    sprintf(name, "r%03d-s%u", rooms, seed);
+    return name;
+}
+
+// json text of instance, bestKnown is written if it is not empty
+inline string generateProblem(uint32_t seed, int rooms, const string& bestKnown = "")
+{
+    PhiloxStream stream(seed, rooms);
+    RandomStream& random = stream;
+    char buffer[256];
+    string json;
+
+    // space
+    double area = instanceArea * rooms * (0.8 + 0.4 * random.uniform());
+    double aspect = 0.6 + random.uniform();
+    double width = sqrt(area * aspect), height = area / width;
+    double thickness = 1 + 0.5 * max(0.0, log(rooms / 5.0) / log(40.0));
+
+    int light[4], sides = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        light[i] = random.flip(0.5) ? 1 + int(random.uniform(2)) : 0;
+        sides += light[i] > 0;
+    }
+    if (! sides)
+        light[int(random.uniform(4))] = 2;
+
+    json += "{\n";
+    sprintf(buffer, "    \"instance\": { \"seed\": %u, \"rooms\": %d },\n", seed, rooms);
+    json += buffer;
+    if (! bestKnown.empty())
+        json += "    \"best known\": " + bestKnown + ",\n";
+    json += "    \"min length\": 2,\n";
+    json += "    \"house\": {\n";
+    sprintf(buffer, "        \"space\": { \"width\": %.2f, \"height\": %.2f, \"wall\": %.2f, \"out wall\": %.2f, \"light\": [%d, %d, %d, %d] },\n", width, height, instanceWall * thickness, instanceOutWall * thickness, light[0], light[1], light[2], light[3]);
+    json += buffer;
+
+    // rooms, cores first
+    vector<string> names;
+    vector<int> parents; // index of room entered from, -1 for access space
+    vector<int> cores;
+
+    json += "        \"rooms\": {\n";
+    sprintf(buffer, "            \"livingroom\": { \"share\": %d }", max(8, rooms * 2));
+    json += buffer;
+
+    int coreCount = 1 + (rooms - 1) / 40;
+    for (int c = 0; c < coreCount && int(names.size()) + 2 <= rooms; c++)
+    {
+        sprintf(buffer, ",\n            \"stairs%d\": { \"width\": 4.5, \"height\": 2.5 }", c + 1);
+        json += buffer;
+        sprintf(buffer, ",\n            \"elevator%d\": { \"width\": 2, \"height\": 1.6 }", c + 1);
+        json += buffer;
+
+        sprintf(buffer, "stairs%d", c + 1); names.push_back(buffer); parents.push_back(-1);
+        cores.push_back(names.size() - 1);
+        sprintf(buffer, "elevator%d", c + 1); names.push_back(buffer); parents.push_back(names.size() - 2);
+    }
+
+    vector<int> counts(instanceKindCount, 0);
+    int first = names.size(); // of rooms out of cores
+    while (int(names.size()) < rooms)
+    {
+        const InstanceKind& kind = instanceKinds[int(random.uniform(instanceKindCount))];
+        int k = &kind - instanceKinds;
+
+        sprintf(buffer, "%s%d", kind.name, ++counts[k]);
+        names.push_back(buffer);
+        sprintf(buffer, ",\n            \"%s\": { \"share\": %d", names.back().c_str(), kind.share);
+        json += buffer;
+        if (kind.light)
+            json += ", \"light\": 1";
+        json += " }";
+
+        // inner rooms behind an earlier room, others mostly on access space
+        int parent = -1, earlier = names.size() - 1 - first;
+        if ((kind.inner || random.flip(0.2)) && earlier > 0)
+            parent = first + int(random.uniform(earlier));
+        else if (! cores.empty() && random.flip(0.1))
+            parent = cores[int(random.uniform(cores.size()))];
+        parents.push_back(parent);
+    }
+    json += "\n        },\n";
+
+    // access, every edge explicit as rooms linked by edges are not entered
+    // from access space otherwise
+    vector<string> edges(names.size() + 1); // by room entered from, access space last
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        bool core = find(cores.begin(), cores.end(), int(i)) != cores.end();
+        string& to = edges[parents[i] < 0 ? names.size() : parents[i]];
+        if (! core)
+            to += (to.empty() ? "\"" : ", \"") + names[i] + "\"";
+        else
+            edges[i] = "\"livingroom\"";
+    }
+
+    json += "        \"access\": {\n";
+    json += "            \"start\": \"" + (cores.empty() ? string("livingroom") : names[cores[0]]) + "\",\n";
+    json += "            \"space\": \"livingroom\",\n";
+    json += "            \"edges\": {\n";
+    json += "                \"livingroom\": [" + edges[names.size()] + "]";
+    for (size_t i = 0; i < names.size(); i++)
+        if (! edges[i].empty())
+            json += ",\n                \"" + names[i] + "\": [" + edges[i] + "]";
+    json += "\n            }\n";
+    json += "        }\n";
+    json += "    }\n";
+    json += "}\n";
+    return json;
+}
+
+#endif
@@ -0,0 +1,160 @@
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <vector>
+#include <stdlib.h>
+using namespace std;
+
+// Minimal json reader for problem files
+
+class Json {
+public:
+    enum Type { Null, Bool, Number, String, Array, Object };
+
+    Type type;
+    double number;
+    string text;
+    vector<Json> items;  // array items or object values
+    vector<string> keys; // object keys, in file order
+
+    Json()
+        : type(Null), number(0)
+    {}
+
+    bool has(const string& key) const
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+            if (keys[i] == key) return true;
+        return false;
+    }
+
+    const Json& operator[](const string& key) const
+    {
+        static Json null;
+        for (size_t i = 0; i < keys.size(); i++)
+            if (keys[i] == key) return items[i];
+        return null;
+    }
+
+    double get(const string& key, double value) const
+    {
+        const Json& item = (*this)[key];
+        return item.type == Number ? item.number : value;
+    }
+
+    static bool parse(const string& text, Json& json)
+    {
+        size_t p = 0;
+        if (! json.read(text, p)) return false;
+
+        skip(text, p);
+        return p == text.size();
+    }
+
+private:
+    static void skip(const string& s, size_t& p)
+    {
+        while (p < s.size() && (s[p] == ' ' || s[p] == '\t' || s[p] == '\n' || s[p] == '\r'))
+            p++;
+    }
+
+    static bool readString(const string& s, size_t& p, string& value)
+    {
+        if (s[p] != '"') return false;
+
+        value.clear();
+        for (p++; p < s.size() && s[p] != '"'; p++)
+        {
+            if (s[p] == '\\' && p + 1 < s.size())
+                p++;
+            value += s[p];
+        }
+
+        if (p == s.size()) return false;
+        p++;
+        return true;
+    }
+
+    bool read(const string& s, size_t& p)
+    {
+        skip(s, p);
+        if (p == s.size()) return false;
+
+        if (s[p] == '{')
+        {
+            type = Object;
+            for (p++; ; p++)
+            {
+                skip(s, p);
+                if (p < s.size() && s[p] == '}' && keys.size() == 0) break;
+
+                string key;
+                if (p == s.size() || ! readString(s, p, key)) return false;
+
+                skip(s, p);
+                if (p == s.size() || s[p] != ':') return false;
+                p++;
+
+                keys.push_back(key);
+                items.push_back(Json());
+                if (! items.back().read(s, p)) return false;
+
+                skip(s, p);
+                if (p == s.size()) return false;
+                if (s[p] == '}') break;
+                if (s[p] != ',') return false;
+            }
+            p++;
+        }
+        else if (s[p] == '[')
+        {
+            type = Array;
+            for (p++; ; p++)
+            {
+                skip(s, p);
+                if (p < s.size() && s[p] == ']' && items.size() == 0) break;
+
+                items.push_back(Json());
+                if (! items.back().read(s, p)) return false;
+
+                skip(s, p);
+                if (p == s.size()) return false;
+                if (s[p] == ']') break;
+                if (s[p] != ',') return false;
+            }
+            p++;
+        }
+        else if (s[p] == '"')
+        {
+            type = String;
+            return readString(s, p, text);
+        }
+        else if (s.compare(p, 4, "true") == 0 || s.compare(p, 5, "false") == 0)
+        {
+            type = Bool;
+            number = s[p] == 't';
+            p += s[p] == 't' ? 4 : 5;
+        }
+        else if (s.compare(p, 4, "null") == 0)
+        {
+            type = Null;
+            p += 4;
+        }
+        else
+        {
+            const char* start = s.c_str() + p;
+            char* end;
+            number = strtod(start, &end);
+            if (end == start) return false;
+
+            type = Number;
+            p += end - start;
+        }
+
+        return true;
+    }
+};
+
+#endif
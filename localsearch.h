@@ -0,0 +1,83 @@
+
+#ifndef LOCALSEARCH_H
+#define LOCALSEARCH_H
+
+// needs evaluate.h to be included before
+
+#include "random.h"
+
+// hadRealNeighbor moves: one gene shifted by at most hcEpsilon
+const size_t neighbors = 20;
+const double hcEpsilon = 0.5;
+
+// picks a gene index out of uniform value, skipping genes of pinned rooms
+inline int movableGene(const vector<bool>& pinned, double uniform)
+{
+    size_t movable = 0;
+    for (size_t i = 0; i < pinned.size(); i++)
+        if (! pinned[i]) movable++;
+
+    if (movable == 0) return -1;
+
+    size_t gene = size_t(4 * movable * uniform), room = gene / 4;
+    for (size_t i = 0; i < pinned.size(); i++)
+        if (! pinned[i] && room-- == 0)
+            return 4 * i + gene % 4;
+
+    return -1;
+}
+
+
+// Hill climbing
+
+class HillClimbing {
+public:
+    House* house;
+    vector<double> genome;
+    vector<bool> pinned; // rooms which local search must not move
+    double value;
+    RandomStream& random;
+
+    HillClimbing(House* _house, GENOME _genome, const vector<bool>& _pinned, RandomStream& _random)
+        : house(_house), genome(_genome.begin(), _genome.end()), pinned(_pinned), random(_random)
+    {
+        pinned.resize(house->rooms, false);
+        value = real_value(house, genome);
+    }
+
+    // neutral hill climbing step, same as moNeutralHC over hadRealNeighbor
+    // returns false if no neighbor is as good as current genome
+    bool step()
+    {
+        TRACE_ZONE("hillClimbingStep");
+
+        int index, bestIndex = -1;
+        double diff, bestDiff = 0, fitness, bestFitness = 0;
+
+        for (size_t i = 0; i < neighbors; i++)
+        {
+            index = movableGene(pinned, random.uniform());
+            if (index < 0) return false;
+            diff = hcEpsilon * (random.uniform() * 2 - 1);
+
+            genome[index] += diff;
+            fitness = real_value(house, genome);
+            genome[index] -= diff;
+
+            if (bestIndex == -1 || fitness < bestFitness)
+            {
+                bestIndex = index; bestDiff = diff; bestFitness = fitness;
+            }
+        }
+
+        if (bestFitness > value)
+            return false;
+
+        genome[bestIndex] += bestDiff;
+        value = bestFitness;
+        if (house->telemetry) house->telemetry->localSearchSteps++;
+        return true;
+    }
+};
+
+#endif
@@ -5,14 +5,18 @@
 #include <QDir>
 #include <QDesktopWidget>
 #include <QDateTime>
+#include <QMap>
 
 #include <evaluate.h>
+#include <localsearch.h>
+#include <generations.h>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    lastSize = 0;
 
     ui->gGenome->setVisible(false);
 
@@ -27,6 +31,13 @@ MainWindow::MainWindow(QWidget *parent) :
 
     viewerThread = new ViewerThread(this);
 
+    searchThread = new SearchThread;
+    connect(ui->viewer, SIGNAL(grabbed()), this, SLOT(stopSearch()));
+    connect(ui->viewer, SIGNAL(released()), this, SLOT(startSearch()));
+    connect(&searchTimer, SIGNAL(timeout()), this, SLOT(showSearchResult()));
+
+    loadProblem();
+
     resize(800, 600);
     this->move(QApplication::desktop()->screen()->rect().center()-this->rect().center());
 
@@ -62,6 +73,7 @@ void MainWindow::planClick(vector<double> genome)
 {
     if (ui->frame->isVisible())
     {
+        stopSearch();
         ui->grid->setFocus();
         ui->frame->hide();
         return;
@@ -72,6 +84,8 @@ void MainWindow::planClick(vector<double> genome)
 
 MainWindow::~MainWindow()
 {
+    stopSearch();
+    TRACE_WRITE("trace.json");
     delete ui;
 }
 
@@ -84,17 +98,59 @@ void ViewerThread::run()
     }
 }
 
-// filename: "generations#.sav"
-struct FilenameLessThan {
-    bool operator()(const QString &s1, const QString &s2) const {
+SearchThread::SearchThread()
+    : canceled(false), improved(false)
+{
+    house = new House(*House::house);
+}
 
-        int start = s1.indexOf("generations") + QString("generations").size();
-        int i1 =  s1.mid(start, s1.size() - start - 4).toInt();
-        int i2 =  s2.mid(start, s2.size() - start - 4).toInt();
-        return i1 < i2;
-    }
-};
+void SearchThread::search(const vector<double>& g, const vector<bool>& _pinned)
+{
+    cancel();
 
+    genome = g;
+    pinned = _pinned;
+    canceled = false;
+    start(QThread::LowPriority);
+}
+
+void SearchThread::cancel()
+{
+    canceled = true;
+    wait();
+
+    QMutexLocker locker(&mutex);
+    improved = false;
+}
+
+bool SearchThread::takeImproved(vector<double>& g)
+{
+    QMutexLocker locker(&mutex);
+    if (! improved) return false;
+
+    g = best;
+    improved = false;
+    return true;
+}
+
+void SearchThread::run()
+{
+    const int maxStep = 5000;
+
+    PhiloxStream random(QDateTime::currentDateTime().toTime_t());
+    HillClimbing hc(house, genome, pinned, random);
+    double value = hc.value;
+
+    for (int i = 0; i < maxStep && ! canceled && hc.step(); i++)
+        if (hc.value < value)
+        {
+            value = hc.value;
+
+            QMutexLocker locker(&mutex);
+            best = hc.genome;
+            improved = true;
+        }
+}
 
 void MainWindow::on_bExecute_clicked()
 {
@@ -104,6 +160,7 @@ void MainWindow::on_bExecute_clicked()
     if (ui->bExecute->text() == tr("Execute"))
     {
         ui->cShow->setCurrentIndex(0);
+        loadProblem();
 
         thread->command = command;
         thread->start();
@@ -123,21 +180,32 @@ void MainWindow::on_bExecute_clicked()
 
 }
 
-vector<double> getGenome(QString g)
+// problem of command, built-in house without --problem
+void MainWindow::loadProblem()
 {
-    vector<double> genome;
-    QStringList values = g.split(" ");
-    int size = House::house->rooms * 4;
+    QRegExp param("--problem=(\\S+)");
+    QString command = ui->eCommand->toPlainText();
 
-    int i = 0;
-    for (; values[i].toDouble() != size; i++);
-    for (int j = i+1; (j < values.size()) && (j - i <= size); j++)
-        genome.push_back(values[j].toDouble());
+    House house;
+    if (param.indexIn(command) >= 0 && ! house.load(param.cap(1).toLocal8Bit().data()))
+        qDebug() << "Could not read problem" << param.cap(1);
 
-    return genome;
+    QStringList names;
+    for (size_t i = 0; i < house.rooms; i++)
+        names << QString::fromStdString(house.room[i].name);
+    PlanViewer::setProblem(names, house.original_width, house.original_height, house.wall, house.out_wall);
+
+    stopSearch();
+    *House::house = house;
+    *searchThread->house = house;
+}
+
+vector<double> getGenome(QString g)
+{
+    return getGenome(g, House::house->rooms * 4);
 }
 
-double genomeDiff(vector<double> g1, vector<double> g2)
+double genomeDiff(GenomeView g1, GenomeView g2)
 {
     double maxDiff = 0;
     for (size_t i = 0; i < g1.size(); i++)
@@ -156,15 +224,15 @@ void MainWindow::addNewSelectedSolution(QString& item, QStringList& solutions)
     double maxPenalty = ui->sFeasible->value();
 
     vector<double> genome = getGenome(item);
-    House::house->update(genome);
+    Evaluation evaluation = evaluate(House::house, genome);
 
-    if (House::house->getAreaPenalty() < maxPenalty && House::house->getIntersectionPenalty() < maxPenalty)
+    if (evaluation.area < maxPenalty && evaluation.intersection < maxPenalty)
     {
         size_t newResult = true;
         for (size_t j = 0; j < solutions.size(); j++)
             if (genomeDiff(genome, getGenome(solutions[j])) < minDiff)
             {
-                if (real_value(genome) < real_value(getGenome(solutions[j])))
+                if (evaluation.total < real_value(getGenome(solutions[j])))
                     solutions[j] = item;
 
                 newResult = false;
@@ -176,29 +244,49 @@ void MainWindow::addNewSelectedSolution(QString& item, QStringList& solutions)
     }
 }
 
-void MainWindow::loadGeneration(int index)
+bool MainWindow::appendGeneration(QString filename)
 {
-    if (index < 0 || index > generations.size() - 1) return;
-    gen = index;
+    TRACE_ZONE("appendGeneration");
 
-    QFile file(generations[gen]);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-        return;
+    // stamp before reading, so a write during reading is seen later
+    QFileInfo info(filename);
+    lastSize = info.size();
+    lastModified = info.lastModified();
 
-    setWindowTitle(tr("Human Aided Design") + " - " + QFileInfo(generations[gen]).fileName());
+    QStringList lines;
+    if (! readGeneration(filename, lines))
+        return false;
 
-    population.clear();
+    vector<double> values(lines.size());
+    vector< vector<double> > genomes(lines.size());
+    for (int i = 0; i < lines.size(); i++)
+    {
+        values[i] = genomeValue(lines[i]);
+        genomes[i] = getGenome(lines[i]);
+    }
 
-    while (!file.atEnd()) {
-        QString line = file.readLine();
+    history.append(values, genomes);
+    processedFiles << filename;
+    return true;
+}
 
-        if (line.startsWith("\\section{eoPop}"))
-        {
-           int size = file.readLine().trimmed().toInt();
+void MainWindow::loadGeneration(int index)
+{
+    vector<double> values;
+    vector< vector<double> > genomes;
+    if (! history.get(index, values, genomes)) return;
+    gen = index;
 
-           for (int i = 0; i < size; i++)
-               population << file.readLine();
-        }
+    setWindowTitle(tr("Human Aided Design") + " - " + QFileInfo(processedFiles[gen]).fileName());
+
+    int size = House::house->rooms * 4;
+    population.clear();
+    for (size_t i = 0; i < genomes.size(); i++)
+    {
+        QString line = QString("%1 %2").arg(values[i]).arg(size);
+        for (size_t j = 0; j < genomes[i].size(); j++)
+            line += QString(" %1").arg(genomes[i][j]);
+        population << line;
     }
 
     // select solutions
@@ -237,8 +325,43 @@ double present(double value)
     return -1 * round(1000 * value) / 1000;
 }
 
+void MainWindow::startSearch()
+{
+    if (! ui->cLiveSearch->isChecked())
+        return;
+
+    vector<bool> pinned;
+    if (ui->cPinRooms->isChecked())
+        pinned = ui->viewer->touched;
+
+    searchThread->search(ui->viewer->genome, pinned);
+    searchTimer.start(200);
+}
+
+void MainWindow::stopSearch()
+{
+    searchTimer.stop();
+    searchThread->cancel();
+}
+
+void MainWindow::showSearchResult()
+{
+    bool finished = searchThread->isFinished();
+
+    vector<double> genome;
+    if (searchThread->takeImproved(genome))
+    {
+        ui->viewer->setGenome(genome, true);
+        displayEvaluations();
+    }
+
+    if (finished)
+        searchTimer.stop();
+}
+
 void MainWindow::showSolution(vector<double> genome)
 {
+    stopSearch();
     ui->viewer->setGenome(genome);
     displayEvaluations();
     ui->frame->show();
@@ -246,7 +369,7 @@ void MainWindow::showSolution(vector<double> genome)
 
 void MainWindow::displayEvaluations()
 {
-    vector<double> genome = ui->viewer->genome;
+    GenomeView genome = ui->viewer->genome;
     House* house = House::house;
     int size = house->rooms * 4;
 
@@ -258,33 +381,65 @@ void MainWindow::displayEvaluations()
         tmp += QString(" %1").arg(genome[i]);
     ui->eGenome->setText(tmp);
 
-    ui->lSum->setText(QString("%1").arg(present(real_value(genome))));
-
-    double areaPenalty = 0, intersectionPenalty = 0, accessPenalty = 0, lightPenalty = 0, spacePenalty = 0, sidePenalty = 0;
-    areaPenalty = house->getAreaPenalty();
-    intersectionPenalty = house->getIntersectionPenalty();
-    sidePenalty = house->getSidePenalty();
+    // evaluated on main house, whose spaces are drawn
+    Evaluation evaluation = evaluate(house, genome);
+    ui->lSum->setText(QString("%1").arg(present(evaluation.total)));
 
-    house->updateSpaces();
     vector<Rect>& spaces = house->spaces;
     ui->viewer->spaces.clear();
     for (int i = 0; i < spaces.size(); i++)
         ui->viewer->spaces.push_back(QRectF(spaces[i].x1, spaces[i].y1, spaces[i].x2 - spaces[i].x1, spaces[i].y2 - spaces[i].y1));
     ui->viewer->update();
 
-    if (house->spaces.size() > 0)
-    {
-        spacePenalty = -1 * house->getSpaceProfit();
-        lightPenalty = -1 *house->getLightProfit();
-        accessPenalty = house->getAccessPenalty();
-    }
+    ui->lAreaPenalty->setText(QString("%1").arg(present(evaluation.area)));
+    ui->lIntersectionPenalty->setText(QString("%1").arg(present(evaluation.intersection)));
+    ui->lSidePenalty->setText(QString("%1").arg(present(evaluation.side)));
+    ui->lAccessPenalty->setText(QString("%1").arg(present(evaluation.access)));
+    ui->lLightPenalty->setText(QString("%1").arg(present(-1 * evaluation.light)));
+    ui->lSpacePenalty->setText(QString("%1").arg(present(-1 * evaluation.space)));
+}
+
+void MainWindow::displayTelemetry(QString filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return;
 
-    ui->lAreaPenalty->setText(QString("%1").arg(present(areaPenalty)));
-    ui->lIntersectionPenalty->setText(QString("%1").arg(present(intersectionPenalty)));
-    ui->lSidePenalty->setText(QString("%1").arg(present(sidePenalty)));
-    ui->lAccessPenalty->setText(QString("%1").arg(present(accessPenalty)));
-    ui->lLightPenalty->setText(QString("%1").arg(present(lightPenalty)));
-    ui->lSpacePenalty->setText(QString("%1").arg(present(spacePenalty)));
+    // columns by header, then last row only
+    QStringList header = QString(file.readLine()).trimmed().split(",");
+    file.seek(max(file.pos(), file.size() - 1024));
+    QStringList lines = QString(file.readAll()).split("\n", QString::SkipEmptyParts);
+    if (lines.size() < 1) return;
+
+    QStringList values = lines.last().split(",");
+    if (values.size() != header.size()) return;
+
+    QMap<QString, QString> row;
+    for (int i = 0; i < header.size(); i++)
+        row[header[i]] = values[i].trimmed();
+
+    ui->lEvaluationRate->setText(QString("%1").arg(row["evaluationsPerSecond"].toDouble(), 0, 'f', 0));
+    ui->lGenerationTime->setText(QString("%1").arg(1000 * row["generationTime"].toDouble(), 0, 'f', 1));
+
+    QStringList components = QStringList() << "update" << "area" << "intersection" << "side" << "spaces" << "access" << "light" << "space";
+    QStringList names = QStringList() << tr("Update") << tr("Area") << tr("Intersection") << tr("Side") << tr("Spaces") << tr("Access") << tr("Light") << tr("Space");
+    QString times;
+    for (int i = 0; i < components.size(); i++)
+        times += QString("%1: %2\n").arg(names[i]).arg(1000 * row[components[i]].toDouble(), 0, 'f', 2);
+    ui->lComponentTimes->setText(times.trimmed());
+
+    ui->lLocalSearch->setText(row["localSearchSteps"]);
+
+    // moeo runs, of a recent generation
+    if (! row["hypervolume"].isEmpty())
+        ui->lHypervolume->setText(QString::fromUtf8("%1 ± %2 (%3)").arg(row["hypervolume"].toDouble(), 0, 'f', 5).arg(row["hypervolumeError"].toDouble(), 0, 'g', 2).arg(row["hypervolumeGeneration"]));
+    else
+        ui->lHypervolume->setText("");
+
+    if (row.contains("centroidDistance"))
+        ui->lDiversity->setText(tr("%1 m, %2 restarts").arg(row["centroidDistance"].toDouble(), 0, 'f', 3).arg(row["restarts"]));
+    else
+        ui->lDiversity->setText("");
 }
 
 void MainWindow::on_sGenerations_sliderMoved(int position)
@@ -294,25 +449,43 @@ void MainWindow::on_sGenerations_sliderMoved(int position)
 
 void MainWindow::on_bLoad_clicked()
 {
+    TRACE_ZONE("load");
+
     // load list of generation files
-    generations.clear();
     QDir dir("/home/alireza/repo/had/input");
-    QFileInfoList list = dir.entryInfoList();
+    if (! dir.exists()) return;
+    generations = generationFiles(dir);
+
+    // a new run erased previous files
+    if (generations.count() < processedFiles.count() || (processedFiles.count() > 0 && generations[0] != processedFiles[0]))
+    {
+        history.clear();
+        processedFiles.clear();
+    }
 
-    if (list.size() == 0) return;
+    // last file read may have been incomplete, read again if it changed
+    if (processedFiles.count() > 0)
+    {
+        QFileInfo info(processedFiles.last());
+        if (info.size() != lastSize || info.lastModified() != lastModified)
+        {
+            history.truncate(history.size() - 1);
+            processedFiles.removeLast();
+        }
+    }
 
-    for (int i = 0; i < list.size(); i++)
-        if (list.at(i).filePath().endsWith(".sav"))
-            generations << list.at(i).filePath();
+    // parse only new generations
+    for (int i = processedFiles.count(); i < generations.count(); i++)
+        if (! appendGeneration(generations[i]))
+            break;
 
-    FilenameLessThan le;
-    qSort(generations.begin(), generations.end(), le);
+    displayTelemetry(dir.filePath("telemetry.csv"));
 
-    if (generations.count() > 0)
+    if (history.size() > 0)
     {
-        ui->sGenerations->setMaximum(generations.count()-1);
-        ui->sGenerations->setValue(generations.count()-1);
-        loadGeneration(generations.count()-1);
+        ui->sGenerations->setMaximum(history.size()-1);
+        ui->sGenerations->setValue(history.size()-1);
+        loadGeneration(history.size()-1);
     }
 
     showPopulation();
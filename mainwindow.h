@@ -5,8 +5,12 @@
 #include <QThread>
 #include <QProcess>
 #include <QMainWindow>
+#include <QMutex>
+#include <QTimer>
+#include <QDateTime>
 
 #include <planviewer.h>
+#include <history.h>
 
 class GAThread : public QThread
 {
@@ -44,6 +48,32 @@ public:
 };
 
 
+class House;
+
+// local search from an edited genome, in background of viewer
+class SearchThread : public QThread
+{
+public:
+    House* house;
+    vector<double> genome;
+    vector<bool> pinned;
+    volatile bool canceled;
+
+    SearchThread();
+
+    void search(const vector<double>& g, const vector<bool>& _pinned);
+    void cancel();
+    bool takeImproved(vector<double>& g);
+
+    void run();
+
+private:
+    QMutex mutex;
+    vector<double> best;
+    bool improved;
+};
+
+
 namespace Ui {
     class MainWindow;
 }
@@ -58,17 +88,25 @@ public:
 
     QStringList generations, population, selectedSolutions, processedFiles;
     int gen;
+    History history;
+    qint64 lastSize; // of last processed file, which engine may still write
+    QDateTime lastModified;
 
     GAThread* thread;
     ViewerThread* viewerThread;
+    SearchThread* searchThread;
+    QTimer searchTimer;
 
     vector<PlanViewer*> plans;
 
+    void loadProblem();
+    bool appendGeneration(QString filename);
     void loadGeneration(int index);
     void sortPopulation();
     void addNewSelectedSolution(QString& item, QStringList& solutions);
 
     void showSolution(vector<double> genome);
+    void displayTelemetry(QString filename);
     void showPopulation();
 
     void resizeEvent (QResizeEvent * event);
@@ -91,6 +129,12 @@ public slots:
 
     void planClick(vector<double> genome);
 
+    void startSearch();
+
+    void stopSearch();
+
+    void showSearchResult();
+
 private:
     Ui::MainWindow *ui;
 };
@@ -13,6 +13,15 @@
 
 using namespace std;
 
+#include </home/alireza/repo/had/operators.h>
+#include </home/alireza/repo/had/breeder.h>
+#include </home/alireza/repo/had/saver.h>
+#include </home/alireza/repo/had/archive.h>
+#include </home/alireza/repo/had/hypervolume.h>
+#include </home/alireza/repo/had/indicator.h>
+#include </home/alireza/repo/had/diversity.h>
+#include </home/alireza/repo/had/fidelity.h>
+
 
 class HADObjectiveVectorTraits : public moeoObjectiveVectorTraits {
 public:
@@ -28,113 +37,174 @@ public:
 };
 
 // evaluation of objective functions
-class HADEval : public moeoEvalFunc<HAD>
+class HADEval : public moeoEvalFunc<HAD>, public hadHouseEval<HAD>
 {
 public:
+    HADEval(RepairMode _mode = NoRepair)
+        : mode(_mode)
+    {}
+
     void operator () (HAD& g)
+    {
+        (*this)(g, House::house);
+    }
+
+    bool operator () (HAD& g, House* house)
     {
         if (g.invalidObjectiveVector())
         {
             HADObjectiveVector objVec;
-            House* house = House::house;
-
-            const int rooms = 4 * house->rooms;
-            vector<double> genome(rooms);
-            for (int i = 0; i < rooms; i++)
-                genome[i] = g[i];
 
-            house->update(genome);
-            objVec[0] = house->getAreaPenalty();
-            objVec[1] = house->getIntersectionPenalty();
-            objVec[2] = house->getSidePenalty();
-
-            house->updateSpaces();
-            if (house->spaces.size() > 0)
+            // in place, only repairs need a copy
+            Evaluation e;
+            if (mode == NoRepair)
+                e = evaluate(house, g);
+            else
             {
-                objVec[3] = house->getAccessPenalty();
-                objVec[4] = house->getSpaceProfit();
-                objVec[5] = house->getLightProfit();
-              }
+                vector<double> genome(g.begin(), g.end());
+                repairPlan(house, genome);
+                if (mode == Lamarckian)
+                    copy(genome.begin(), genome.end(), g.begin());
+                e = evaluate(house, genome);
+            }
+            objVec[0] = e.area; objVec[1] = e.intersection; objVec[2] = e.side;
+            objVec[3] = e.access; objVec[4] = e.space; objVec[5] = e.light;
 
             g.objectiveVector(objVec);
+            return true;
         }
+
+        return false;
     }
+
+private:
+    RepairMode mode;
 };
 
+// credit of a mutation for adaptive operators, offspring dominating parent
+double operatorCredit(const HAD& parent, const HAD& child)
+{
+    return child.objectiveVector().dominates(parent.objectiveVector()) ? 1 : 0;
+}
 
-// Operators
+// coarse fidelity, full for plans not dominated by archive, which may enter it
+class hadArchiveFidelityEval : public hadFidelityEval<HAD>
+{
+public:
+    hadArchiveFidelityEval(hadHouseEval<HAD>& _eval, hadBoundedArchive<HAD>& _archive, int _coarseWebSize)
+        : hadFidelityEval<HAD>(_eval, _coarseWebSize), archive(_archive)
+    {}
+
+    void screen(const eoPop<HAD>&)
+    {
+        screening = archive.size() > 0;
+    }
+
+protected:
+    bool promising(const HAD& g)
+    {
+        return ! archive.dominates(g.objectiveVector());
+    }
+
+private:
+    hadBoundedArchive<HAD>& archive; // its dominates of tree, not of moeoArchive
+};
 
-template<class GenotypeT>
-class RoomExchangeCrossover: public eoQuadOp<GenotypeT>
+
+// Hypervolume
+
+// archive of each generation to monitor, latest value to telemetry; its
+// generation and monitor are part of run state
+class hadHypervolumeUpdater : public eoUpdater, public eoPersistent
 {
-    const double pCrossExchange;
+    moeoArchive<HAD>& archive;
+    HypervolumeMonitor& monitor;
+    Telemetry& telemetry;
+    int generation;
 
 public:
-    RoomExchangeCrossover(double _pExchange = 0.1)
-        : pCrossExchange(_pExchange)
+    hadHypervolumeUpdater(moeoArchive<HAD>& _archive, HypervolumeMonitor& _monitor, Telemetry& _telemetry)
+        : archive(_archive), monitor(_monitor), telemetry(_telemetry), generation(0)
     {}
 
-    string className() const { return "RoomExchangeCrossover"; }
-
-    // modifies both parents
-    bool operator()(GenotypeT& g1, GenotypeT & g2)
+    void operator()()
     {
-        bool oneAtLeastIsModified(false);
+        const unsigned objectives = HADObjectiveVectorTraits::nObjectives();
 
-        double tmp;
-        const size_t rooms = House::house->rooms;
-        for (size_t t, j, i = 0; i < rooms; i++)
-            if (rng.flip(pCrossExchange))
-            {
-                for (t = 4*i, j = 0; j < 4; j++)
-                {
-                    tmp = g1[t+j];
-                    g1[t+j] = g2[t+j];
-                    g2[t+j] = tmp;
-                }
-
-                if (!oneAtLeastIsModified) oneAtLeastIsModified = true;
-            }
+        vector<double> costs;
+        for (size_t i = 0; i < archive.size(); i++)
+            for (unsigned j = 0; j < objectives; j++)
+                costs.push_back(HADObjectiveVectorTraits::minimizing(j) ? archive[i].objectiveVector()[j] : -archive[i].objectiveVector()[j]);
+
+        if (costs.size())
+            monitor.submit(generation, costs, objectives);
+        generation++;
+
+        monitor.latest(telemetry.hypervolumeGeneration, telemetry.hypervolume, telemetry.hypervolumeError);
+    }
+
+    void printOn(ostream& os) const
+    {
+        os << generation << ' ';
+        monitor.printOn(os);
+    }
 
-        return oneAtLeastIsModified;
+    void readFrom(istream& is)
+    {
+        is >> generation;
+        monitor.readFrom(is);
     }
 };
 
-template<class GenotypeT>
-class RoomSwapMutation: public eoMonOp<GenotypeT>
+// stops when hypervolume has not grown beyond its error and tolerance in
+// stagnation generations, 0 for never
+class hadHypervolumeContinue : public eoContinue<HAD>
 {
+    HypervolumeMonitor& monitor;
+    unsigned stagnation;
+    double tolerance;
+
 public:
+    double best;
+    int last, bestGeneration;
 
-    string className() const { return "RoomSwapMutation"; }
+    hadHypervolumeContinue(HypervolumeMonitor& _monitor, unsigned _stagnation, double _tolerance)
+        : monitor(_monitor), stagnation(_stagnation), tolerance(_tolerance), best(0), last(-1), bestGeneration(0)
+    {}
 
-    // modifies parent
-    bool operator()(GenotypeT& g)
+    bool operator()(const eoPop<HAD>&)
     {
-        bool isModified(false);
+        int generation;
+        double value, error;
+        if (! stagnation || ! monitor.latest(generation, value, error))
+            return true;
 
-        const int rooms = House::house->rooms;
-        size_t first = rooms * rng.uniform(), second = rooms * rng.uniform();
-        first *= 4; second *= 4;
-
-        if (first != second)
+        if (generation != last)
         {
-            double  x1 = g[second] + (g[second+2] - g[first+2]) / 2,
-                    y1 = g[second+1] + (g[second+3] - g[first+3]) / 2,
-                    x2 = g[first] + (g[first+2] - g[second+2]) / 2,
-                    y2 = g[first+1] + (g[first+3] - g[second+3]) / 2;
-
-            g[first] = x1; g[first+1] = y1;
-            g[second] = x2; g[second+1] = y2;
-
-            isModified = true;
+            if (last < 0 || value > best + error + tolerance * fabs(best))
+            {
+                best = value;
+                bestGeneration = generation;
+            }
+            last = generation;
         }
 
-        return isModified;
+        if (last - bestGeneration >= int(stagnation))
+        {
+            cout << "STOP in hadHypervolumeContinue: hypervolume has not grown for " << stagnation << " generations\n";
+            return false;
+        }
+        return true;
     }
+
+    string className() const { return "hadHypervolumeContinue"; }
 };
 
+
+// Operators
+
 template <class EOT>
-eoGenOp<EOT> & do_make_op(EOT, eoParser& parser, eoState& state)
+eoGenOp<EOT> & do_make_op(EOT, eoParser& parser, eoState& state, hadVariation<EOT>& variation)
 {
     double  pCross = parser.createParam(0.1, "pCross", "Crossover probability",'C',"Param").value(),
             pRoomExchangeCross = parser.createParam(0.1, "pRoomExchangeCross", "Room exchange probability in Crossover",'E',"Param").value(),
@@ -147,18 +217,23 @@ eoGenOp<EOT> & do_make_op(EOT, eoParser& parser, eoState& state)
     eoPropCombinedQuadOp<EOT>* xover;
     state.storeFunctor(xover);
     eoPropCombinedMonOp<EOT>* mutation;
-    eoMonOp<EOT> *ptMon;
+    StreamMonOp<EOT> *ptMon;
     state.storeFunctor(mutation);
 
     // xover
-    ptQuad = new RoomExchangeCrossover<EOT>(pRoomExchangeCross);
-    xover = new eoPropCombinedQuadOp<EOT>(*ptQuad, 1); state.storeFunctor(ptQuad);
+    RoomExchangeCrossover<EOT>* roomExchange = new RoomExchangeCrossover<EOT>(pRoomExchangeCross);
+    xover = new eoPropCombinedQuadOp<EOT>(*roomExchange, 1); state.storeFunctor(roomExchange);
+    variation.xover = roomExchange;
+    variation.pCross = pCross;
+    variation.pMut = pMut;
 
     // mutation
-    ptMon = new eoUniformMutation<EOT>(mutEpsilon);
+    ptMon = new UniformMutation<EOT>(mutEpsilon);
     mutation = new eoPropCombinedMonOp<EOT>(*ptMon, 1); state.storeFunctor(ptMon);
+    variation.add(*ptMon, 1);
     ptMon = new RoomSwapMutation<EOT>;
     mutation->add(*ptMon, pRoomSwapMut); state.storeFunctor(ptMon);
+    variation.add(*ptMon, pRoomSwapMut);
 
     // a proportional combination of a QuadCopy and crossover
     eoProportionalOp<EOT>* cross = new eoProportionalOp<EOT> ; state.storeFunctor(cross);
@@ -181,32 +256,128 @@ int main (int argc, char *argv[])
     eoState state;                // to keep all things allocated
 
     // generate initial population
-    eoRealVectorBounds bounds (House::house->rooms * 4, 0.0, 6.0);
+    eoRealVectorBounds& bounds = do_make_problem(parser);
+    hadRunState runState(parser);
     eoRealInitBounded<HAD>* init = new eoRealInitBounded<HAD>(bounds);
     state.storeFunctor(init);
     eoPop<HAD>& pop = do_make_pop(parser, state, *init);
+    runState.add("population", pop);
+    runState.add("rng", rng);
+
+    unsigned archiveSize = parser.createParam(unsigned(200), "archiveSize", "Capacity of Pareto archive, 0 for unbounded", '\0', "Evolution Engine").value();
+    hadBoundedArchive<HAD> arch(archiveSize);
 
     // problem independent
-    eoEvalFuncCounter<HAD>* eval = new eoEvalFuncCounter<HAD>(*(new HADEval));
+    HADEval* mainEval = new HADEval(do_make_repair(parser));
+    state.storeFunctor(mainEval);
+    int coarseWebSize = parser.createParam(0, "coarseWebSize", "Probes per side of space detection in early generations, 0 for full fidelity", '\0', "Evolution Engine").value();
+    hadArchiveFidelityEval* houseEval = new hadArchiveFidelityEval(*mainEval, arch, coarseWebSize);
+    state.storeFunctor(houseEval);
+    eoEvalFuncCounter<HAD>* eval = new eoEvalFuncCounter<HAD>(*houseEval);
     state.storeFunctor(eval);
-
-    moeoUnboundedArchive<HAD> arch;
-    eoContinue<HAD>& term = do_make_continue_moeo(parser, state, *eval);
+    runState.addValue("evaluations", eval->value());
+    runState.add("archive", arch);
+    eoContinue<HAD>& term = do_make_continue(parser, state, *eval, runState, false);
+    hadAsyncSaver<HAD>* saver = do_make_async_saver(parser, state, pop, runState);
     eoCheckPoint<HAD>& checkpoint = do_make_checkpoint_moeo(parser, state, *eval, term, pop, arch);
-    eoGenOp<HAD>& op = do_make_op(HAD(), parser, state);
 
+    // coarse fidelity of early generations, before population is saved
+    checkpoint.add(do_make_fidelity_schedule<HAD>(parser, state, pop, *houseEval, *eval, runState));
+    if (saver) checkpoint.add(*saver);
+
+    // telemetry of run, next to generation files
+    string resDir = parser.getORcreateParam(string("Res"), "resDir", "Directory to store DISK outputs", '\0', "Output - Disk").value();
+    hadTelemetryUpdater& telemetryUpdater = do_make_telemetry(parser, state, runState);
+    Telemetry& telemetry = telemetryUpdater.telemetry;
+
+    // hypervolume of archive on a thread of its own, before telemetry row is closed
+    string hypervolume = parser.createParam(string("Exact"), "hypervolume", "Hypervolume of archive: None, Exact or MonteCarlo", '\0', "Output").value();
+    unsigned hvSamples = parser.createParam(unsigned(100000), "hvSamples", "Samples of MonteCarlo hypervolume", '\0', "Output").value();
+    unsigned hvStagnation = parser.createParam(unsigned(0), "hvStagnation", "Stop after generations without hypervolume growth, 0 for never", '\0', "Stopping criterion").value();
+    double hvTolerance = parser.createParam(1e-4, "hvTolerance", "Relative hypervolume growth counted as progress", '\0', "Stopping criterion").value();
+    if (hypervolume != "None" && hypervolume != "Exact" && hypervolume != "MonteCarlo")
+        throw runtime_error("Hypervolume " + hypervolume + " is not supported");
+
+    // Monte Carlo with samples, exact otherwise; thread starts on first submit,
+    // so never without an indicator
+    HypervolumeMonitor monitor(hypervolume == "MonteCarlo" ? hvSamples : 0);
+    hadHypervolumeUpdater hypervolumeUpdater(arch, monitor, telemetry);
+    hadHypervolumeContinue hypervolumeContinue(monitor, hvStagnation, hvTolerance);
+    if (hypervolume != "None")
+    {
+        checkpoint.add(hypervolumeUpdater);
+        checkpoint.add(hypervolumeContinue);
+        runState.add("hypervolume", hypervolumeUpdater);
+        runState.addValue("hypervolumeBest", hypervolumeContinue.best);
+        runState.addValue("hypervolumeLast", hypervolumeContinue.last);
+        runState.addValue("hypervolumeBestGeneration", hypervolumeContinue.bestGeneration);
+    }
+
+    // spread of population only, fitness of renewed individuals would be
+    // assigned only by next replacement
+    hadDiversityMonitor<HAD> diversity(pop, *init, *eval, &telemetry);
+    checkpoint.add(diversity);
+
+    checkpoint.add(telemetryUpdater);
+
+    hadVariation<HAD> variation;
+    eoGenOp<HAD>& op = do_make_op(HAD(), parser, state, variation);
+
+    // NSGA-II components with parallel breeding and evaluation of offspring
+    bool parallel = parser.createParam(false, "parallel", "Breed and evaluate offspring in parallel", '\0', "Evolution Engine").value();
+    unsigned threads = parser.createParam(unsigned(0), "threads", "Number of breeding threads, 0 for all cores", '\0', "Evolution Engine").value();
+    uint32_t seed = parser.getORcreateParam(uint32_t(0), "seed", "Random number seed", '\0').value();
+#ifdef _OPENMP
+    if (threads > 0) omp_set_num_threads(threads);
+#endif
+
+    moeoFastNonDominatedSortingFitnessAssignment<HAD> fitnessAssignment;
+    moeoFrontByFrontCrowdingDiversityAssignment<HAD> diversityAssignment;
+    moeoFitnessThenDiversityComparator<HAD> comparator;
+    moeoDetTournamentSelect<HAD> select(2);
+    moeoElitistReplacement<HAD> replace(fitnessAssignment, diversityAssignment, comparator);
+    hadParallelBreeder<HAD> breed(select, variation, *houseEval, *eval, eoHowMany(1.0), seed);
+    runState.addValue("breeder", breed.generation);
+
+    // adaptive rates of breeder, or of op of serial algorithms
+    eoGenOp<HAD>& serialOp = parallel ? op : do_make_op_serial(parser, state, *eval, checkpoint, op, variation, runState);
+    if (parallel)
+        do_make_operator_selector(parser, state, variation, runState);
+    moeoEasyEA<HAD> parallelAlgo(checkpoint, *eval, breed, replace, fitnessAssignment, diversityAssignment, true);
+
+    // IBEA components with additive epsilon indicator in parallel tiles
+    string algorithm = parser.createParam(string("NSGAII"), "algorithm", "Algorithm: NSGAII or IBEA", '\0', "Evolution Engine").value();
+    double kappa = parser.createParam(0.05, "kappa", "Fitness scaling factor of IBEA", '\0', "Evolution Engine").value();
+    if (algorithm != "NSGAII" && algorithm != "IBEA")
+        throw runtime_error("Algorithm " + algorithm + " is not supported");
+
+    hadIndicatorFitnessAssignment<HAD> indicatorFitness(kappa);
+    moeoDummyDiversityAssignment<HAD> dummyDiversity;
+    hadIndicatorReplacement<HAD> indicatorReplace(indicatorFitness, dummyDiversity);
+    moeoEasyEA<HAD> indicatorAlgo(checkpoint, *eval, serialOp, indicatorReplace, indicatorFitness, dummyDiversity);
+    moeoEasyEA<HAD> parallelIndicatorAlgo(checkpoint, *eval, breed, indicatorReplace, indicatorFitness, dummyDiversity);
 
-    moeoAdditiveEpsilonBinaryMetric<HADObjectiveVector> indicator;
     // run
-    moeoNSGAII<HAD> algo (checkpoint, *eval, op);
-//    moeoIBEA<HAD> algo (checkpoint, *eval, op, indicator);
+    moeoNSGAII<HAD> algo (checkpoint, *eval, serialOp);
+
+    // full state after all other updaters and continuators of generation
+    hadRunStateContinue<HAD> runStateContinue(runState);
+    checkpoint.add(runStateContinue);
 //    moeoNSGA<HAD> algo (checkpoint, *eval, op);
 //    eoAlgo<HAD>& algo = do_make_ea_moeo(parser, state, *eval, checkpoint, op, arch); // moeoEasyEA
 //    moeoSEEA2<HAD> algo (checkpoint, *eval, op, arch);
 //    moeoSEEA<HAD> algo (checkpoint, *eval, op, arch);
 //    moeoMOGA<HAD> algo (checkpoint, *eval, op);
 
-    algo (pop);
+    if (algorithm == "IBEA" && parallel)
+        parallelIndicatorAlgo (pop);
+    else if (algorithm == "IBEA")
+        indicatorAlgo (pop);
+    else if (parallel)
+        parallelAlgo (pop);
+    else
+        algo (pop);
+    TRACE_WRITE((resDir + "/trace.json").c_str());
 
     make_help(parser);
 //    arch.sortedPrintOn (cout);
@@ -0,0 +1,252 @@
+
+#ifndef OPERATORS_H
+#define OPERATORS_H
+
+// needs eo and evaluate.h to be included before
+
+#include <stdexcept>
+
+#include "random.h"
+#include "localsearch.h"
+#include "tabu.h"
+#include "repair.h"
+#include "quantized.h"
+
+// EO's global rng as a stream, used when operators are called by EO
+class hadGlobalStream : public RandomStream {
+public:
+    double uniform()
+    {
+        return rng.uniform();
+    }
+};
+hadGlobalStream globalStream;
+
+
+// Problem
+
+// loads --problem into House::house, then genotype params of make_genotype
+// follow its rooms: positions in 60% of space and sizes by room share of it
+eoRealVectorBounds& do_make_problem(eoParser& _parser)
+{
+    string problem = _parser.createParam(string(""), "problem", "Problem file, built-in house if empty", '\0', "Problem").value();
+    if (problem.size() && ! House::house->load(problem.c_str()))
+        throw runtime_error("Could not read problem " + problem);
+
+    House& house = *House::house;
+    const unsigned size = 4 * house.rooms;
+    unsigned vecSize = _parser.getORcreateParam(size, "vecSize", "The number of variables ", 'n', "Genotype Initialization").value();
+    if (vecSize != size)
+        throw runtime_error("vecSize does not match number of rooms of problem");
+
+    double width = 0.6 * house.space.getWidth(), height = 0.6 * house.space.getHeight(),
+           side = min(min(width, height), 2.5 * sqrt(house.space.getWidth() * house.space.getHeight() / house.rooms));
+
+    vector<double> lows(size, 0.0), highs;
+    for (size_t i = 0; i < house.rooms; i++)
+    {
+        highs.push_back(width); highs.push_back(height);
+        highs.push_back(side); highs.push_back(side);
+    }
+
+    return _parser.getORcreateParam(eoRealVectorBounds(lows, highs), "initBounds", "Bounds for initialization (MUST be bounded)", 'B', "Genotype Initialization").value();
+}
+
+RepairMode do_make_repair(eoParser& _parser)
+{
+    string repair = _parser.createParam(string("None"), "repair", "Repair plans before evaluation: None, Lamarckian or Baldwinian", '\0', "Problem").value();
+
+    if (repair == "None") return NoRepair;
+    if (repair == "Lamarckian") return Lamarckian;
+    if (repair == "Baldwinian") return Baldwinian;
+    throw runtime_error("Repair " + repair + " is not supported");
+}
+
+
+// Operators
+
+// mutation which can also run on a breeding task, with the task's stream and house
+template<class GenotypeT>
+class StreamMonOp: public eoMonOp<GenotypeT>
+{
+public:
+    bool operator()(GenotypeT& g)
+    {
+        return (*this)(g, globalStream, House::house);
+    }
+
+    virtual bool operator()(GenotypeT& g, RandomStream& random, House* house) = 0;
+};
+
+template<class GenotypeT>
+class RoomExchangeCrossover: public eoQuadOp<GenotypeT>
+{
+    const double pCrossExchange;
+
+public:
+    RoomExchangeCrossover(double _pExchange = 0.1)
+        : pCrossExchange(_pExchange)
+    {}
+
+    string className() const { return "RoomExchangeCrossover"; }
+
+    bool operator()(GenotypeT& g1, GenotypeT & g2)
+    {
+        return (*this)(g1, g2, globalStream);
+    }
+
+    // modifies both parents
+    bool operator()(GenotypeT& g1, GenotypeT & g2, RandomStream& random)
+    {
+        TRACE_ZONE("roomExchangeCrossover");
+
+        bool oneAtLeastIsModified(false);
+
+        double tmp;
+        const size_t rooms = House::house->rooms;
+        for (size_t t, j, i = 0; i < rooms; i++)
+            if (random.flip(pCrossExchange))
+            {
+                for (t = 4*i, j = 0; j < 4; j++)
+                {
+                    tmp = g1[t+j];
+                    g1[t+j] = g2[t+j];
+                    g2[t+j] = tmp;
+                }
+
+                if (!oneAtLeastIsModified) oneAtLeastIsModified = true;
+            }
+
+        return oneAtLeastIsModified;
+    }
+};
+
+template<class GenotypeT>
+class RoomSwapMutation: public StreamMonOp<GenotypeT>
+{
+public:
+    using StreamMonOp<GenotypeT>::operator();
+
+    string className() const { return "RoomSwapMutation"; }
+
+    // modifies parent
+    bool operator()(GenotypeT& g, RandomStream& random, House* house)
+    {
+        TRACE_ZONE("roomSwapMutation");
+
+        bool isModified(false);
+
+        const int rooms = House::house->rooms;
+        size_t first = rooms * random.uniform(), second = rooms * random.uniform();
+        first *= 4; second *= 4;
+
+        if (first != second)
+        {
+            double  x1 = geneValue(g[second]) + (geneValue(g[second+2]) - geneValue(g[first+2])) / 2,
+                    y1 = geneValue(g[second+1]) + (geneValue(g[second+3]) - geneValue(g[first+3])) / 2,
+                    x2 = geneValue(g[first]) + (geneValue(g[first+2]) - geneValue(g[second+2])) / 2,
+                    y2 = geneValue(g[first+1]) + (geneValue(g[first+3]) - geneValue(g[second+3])) / 2;
+
+            setGene(g[first], x1); setGene(g[first+1], y1);
+            setGene(g[second], x2); setGene(g[second+1], y2);
+
+            isModified = true;
+        }
+
+        return isModified;
+    }
+};
+
+// eoUniformMutation without bounds, drawing from a given stream
+template<class GenotypeT>
+class UniformMutation: public StreamMonOp<GenotypeT>
+{
+    const double epsilon, pChange;
+
+public:
+    using StreamMonOp<GenotypeT>::operator();
+
+    UniformMutation(double _epsilon, double _pChange = 1.0)
+        : epsilon(_epsilon), pChange(_pChange)
+    {}
+
+    string className() const { return "UniformMutation"; }
+
+    bool operator()(GenotypeT& g, RandomStream& random, House* house)
+    {
+        TRACE_ZONE("uniformMutation");
+
+        bool hasChanged(false);
+
+        for (size_t i = 0; i < g.size(); i++)
+            if (random.flip(pChange))
+            {
+                setGene(g[i], geneValue(g[i]) + epsilon * (2 * random.uniform() - 1));
+                hasChanged = true;
+            }
+
+        return hasChanged;
+    }
+};
+
+// moNeutralHC over hadRealNeighbor moves, without paradiseo-mo
+template<class GenotypeT>
+class HillClimbingMutation: public StreamMonOp<GenotypeT>
+{
+    const unsigned maxStep;
+
+public:
+    using StreamMonOp<GenotypeT>::operator();
+
+    HillClimbingMutation(unsigned _maxStep)
+        : maxStep(_maxStep)
+    {}
+
+    string className() const { return "HillClimbingMutation"; }
+
+    bool operator()(GenotypeT& g, RandomStream& random, House* house)
+    {
+        TRACE_ZONE("hillClimbingMutation");
+
+        HillClimbing hc(house, genomeMetres(g), vector<bool>(), random);
+
+        unsigned step = 0;
+        for (; step < maxStep && hc.step(); step++);
+
+        setGenome(g, hc.genome);
+        return step > 0;
+    }
+};
+
+// tabu search from plan on the task's house, best plan of search replaces it;
+// moves are scored repaired by mode of evaluation of offspring
+template<class GenotypeT>
+class TabuMutation: public StreamMonOp<GenotypeT>
+{
+    const unsigned maxStep, moves, tenure;
+    const double step;
+    const RepairMode mode;
+
+public:
+    using StreamMonOp<GenotypeT>::operator();
+
+    TabuMutation(unsigned _maxStep, unsigned _moves = 20, unsigned _tenure = 7, double _step = 0.5, RepairMode _mode = NoRepair)
+        : maxStep(_maxStep), moves(_moves), tenure(_tenure), step(_step), mode(_mode)
+    {}
+
+    string className() const { return "TabuMutation"; }
+
+    bool operator()(GenotypeT& g, RandomStream& random, House* house)
+    {
+        TRACE_ZONE("tabuMutation");
+
+        TabuSearch tabu(vector<House*>(1, house), genomeMetres(g), random, moves, tenure, step, mode);
+        double start = tabu.value;
+        for (unsigned i = 0; i < maxStep && tabu(); i++);
+
+        setGenome(g, tabu.best);
+        return tabu.bestValue < start;
+    }
+};
+
+#endif
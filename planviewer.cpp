@@ -6,22 +6,53 @@
 
 #include <math.h>
 
+#include "trace.h"
+
 PlanViewer::PlanViewer(QWidget *parent, bool _thumbnail) :
     QWidget(parent), resizeWidth(5), thumbnail(_thumbnail)
 {
-    mouseReleaseEvent(0);
+    drag = resize_x1 = resize_y1 = resize_x2 = resize_y2 = -1;
 }
 
-void PlanViewer::setGenome(vector<double> g)
+void PlanViewer::setGenome(GenomeView g, bool keepTouched)
 {
     spaces.clear();
-    genome = g;
+    if (g.data() != (genome.empty() ? 0 : &genome[0]))
+        genome.assign(g.begin(), g.end());
+
+    if (! keepTouched)
+        touched.assign(genome.size() / 4, false);
+
     update();
 }
 
-double space_width, space_height, wall, out_wall;
+double space_width = 10.6, space_height = 10.05, wall = 0.15, out_wall = 0.3;
 double r;
 
+QStringList PlanViewer::roomNames = QStringList() << "kitchen" << "bedroom1" << "bedroom2" << "bathroom" << "toilet" << "stairs" << "elevator";
+
+void PlanViewer::setProblem(QStringList names, double width, double height, double _wall, double outWall)
+{
+    roomNames = names;
+    space_width = width; space_height = height; wall = _wall; out_wall = outWall;
+}
+
+// translated name, numbered rooms like bedroom2 as "bedroom 2"
+QString PlanViewer::roomName(int index)
+{
+    if (index >= roomNames.count())
+        return QString::number(index + 1);
+
+    QString name = roomNames[index];
+    int digits = name.length();
+    while (digits > 0 && name[digits-1].isDigit())
+        digits--;
+
+    if (digits == name.length() || digits == 0)
+        return tr(name.toUtf8());
+    return tr(name.left(digits).toUtf8()) + " " + name.mid(digits);
+}
+
 void PlanViewer::paintEvent(QPaintEvent * event)
 {
     paintOn(this, true, size());
@@ -29,9 +60,8 @@ void PlanViewer::paintEvent(QPaintEvent * event)
 
 void PlanViewer::paintOn(QPaintDevice * device, bool development, QSize page)
 {
-    QStringList rooms = QStringList() << tr("kitchen") << tr("bedroom")+" 1" << tr("bedroom")+" 2" << tr("bathroom") << tr("toilet") << tr("stairs") << tr("elevator");
+    TRACE_ZONE("paint");
 
-    space_width = 10.6, space_height = 10.05, wall = 0.15, out_wall = 0.3;
     r = min(page.width() / space_width, page.height() / space_height);
 
     QPainter painter(device);
@@ -40,14 +70,14 @@ void PlanViewer::paintOn(QPaintDevice * device, bool development, QSize page)
     painter.drawRect(QRect(0, 0, round(r * space_width), round(r * space_height)));
 
     if (genome.size() > 0)
-    for (int i = 0; i < rooms.count(); i++)
+    for (int i = 0; i < genome.size() / 4; i++)
     {
         QRect room(round(r * (genome[4*i] + out_wall)), round(r * (genome[4*i+1] + out_wall)), round(r * (genome[4*i+2] - wall)), round(r * (genome[4*i+3] - wall)));
 
         if (!thumbnail)
         {
             painter.setPen(Qt::SolidLine);
-            painter.drawText(room, Qt::AlignCenter, rooms[i]);
+            painter.drawText(room, Qt::AlignCenter, roomName(i));
         }
 
         painter.setPen(QColor(50, 50, 50, 120));
@@ -77,7 +107,7 @@ void PlanViewer::mousePressEvent(QMouseEvent *event)
     if (thumbnail || genome.size() == 0)
         return;
 
-    for (int i = 0; i < 7; i++)
+    for (int i = 0; i < genome.size() / 4; i++)
     {
         QRect room(round(r * (genome[4*i] + out_wall)), round(r * (genome[4*i+1] + out_wall)), round(r * (genome[4*i+2] - wall)), round(r * (genome[4*i+3] - wall)));
 
@@ -96,6 +126,7 @@ void PlanViewer::mousePressEvent(QMouseEvent *event)
             if (resize_x1 == -1 && resize_y1 == -1 && resize_x2 == -1 && resize_y2 == -1)
                 drag = i;
 
+            emit grabbed();
             break;
         }
     }
@@ -144,6 +175,10 @@ void PlanViewer::mouseMoveEvent(QMouseEvent *event)
 
     if (change)
     {
+        int rooms[] = {drag, resize_x1, resize_x2, resize_y1, resize_y2};
+        for (int i = 0; i < 5; i++)
+            if (rooms[i] >= 0) touched[rooms[i]] = true;
+
         update();
         emit genomeChanged();
     }
@@ -159,6 +194,9 @@ void PlanViewer::mouseReleaseEvent(QMouseEvent *event)
         return;
     }
 
+    if (drag >= 0 || resize_x1 >= 0 || resize_y1 >= 0 || resize_x2 >= 0 || resize_y2 >= 0)
+        emit released();
+
     drag = -1;
     resize_x1 = -1;
     resize_y1 = -1;
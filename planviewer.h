@@ -7,6 +7,8 @@
 #include <vector>
 using namespace std;
 
+#include "genome.h"
+
 class PlanViewer : public QWidget
 {
     Q_OBJECT
@@ -17,14 +19,21 @@ public:
 
     vector<double> genome;
     vector<QRectF> spaces;
+    vector<bool> touched; // rooms dragged or resized by user
+
+    void setGenome(GenomeView g, bool keepTouched = false);
 
-    void setGenome(vector<double> g);
+    // room names and space of problem, shared by all viewers
+    static void setProblem(QStringList names, double width, double height, double wall, double outWall);
 
 private:
     bool thumbnail;
     const int resizeWidth;
     int drag, resize_x1, resize_y1, resize_x2, resize_y2;
 
+    static QStringList roomNames;
+    QString roomName(int index);
+
     void mousePressEvent(QMouseEvent *event);
     void mouseMoveEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
@@ -34,7 +43,9 @@ public:
 
 signals:
     void genomeChanged();
-    void selected(vector<double> genome);
+    void selected(vector<double> genome); // a copy, viewer may change or go
+    void grabbed();
+    void released();
 
 public slots:
 
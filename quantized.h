@@ -0,0 +1,134 @@
+
+#ifndef QUANTIZED_H
+#define QUANTIZED_H
+
+// needs eo and evaluate.h to be included before
+
+#include <math.h>
+
+// Quantized genomes keep genes as int16 centimetres, a quarter of memory of
+// real genomes, and plans on an exact grid: equal plans have equal genes.
+// Operators read and write genes in metres with geneValue and setGene, so
+// they run on both.
+
+const double geneQuantum = 0.01; // metres of a quantized gene unit
+
+inline double geneValue(double gene)
+{
+    return gene;
+}
+
+inline double geneValue(short gene)
+{
+    return gene * geneQuantum;
+}
+
+inline void setGene(double& gene, double metres)
+{
+    gene = metres;
+}
+
+// nearest unit, saturated to int16
+inline void setGene(short& gene, double metres)
+{
+    double units = floor(metres / geneQuantum + 0.5);
+    gene = short(max(-32767.0, min(32767.0, units)));
+}
+
+template <class Genes>
+vector<double> genomeMetres(const Genes& genes)
+{
+    vector<double> genome(genes.size());
+    for (size_t i = 0; i < genes.size(); i++)
+        genome[i] = geneValue(genes[i]);
+    return genome;
+}
+
+template <class Genes>
+void setGenome(Genes& genes, const vector<double>& genome)
+{
+    for (size_t i = 0; i < genome.size(); i++)
+        setGene(genes[i], genome[i]);
+}
+
+
+// Evaluate
+
+// decoded into scratch genome of house, no allocation once it has grown
+inline Evaluation evaluate(House* house, const vector<short>& genes)
+{
+    vector<double>& genome = house->decoded;
+    genome.resize(genes.size());
+    for (size_t i = 0; i < genes.size(); i++)
+        genome[i] = geneValue(genes[i]);
+    return evaluate(house, genome);
+}
+
+inline double real_value(House* house, const vector<short>& genes)
+{
+    return evaluate(house, genes).total;
+}
+
+
+// Representation
+
+// printed and read in metres, so generation files and checkpoints are
+// same as of real genomes
+template <class FitT>
+class eoQuantized : public eoVector<FitT, short>
+{
+public:
+    eoQuantized(unsigned size = 0)
+        : eoVector<FitT, short>(size, 0)
+    {}
+
+    virtual string className() const { return "eoQuantized"; }
+
+    virtual void printOn(ostream& os) const
+    {
+        EO<FitT>::printOn(os);
+        os << ' ' << this->size();
+        for (size_t i = 0; i < this->size(); i++)
+            os << ' ' << geneValue((*this)[i]);
+    }
+
+    virtual void readFrom(istream& is)
+    {
+        EO<FitT>::readFrom(is);
+
+        unsigned size;
+        double metres;
+        is >> size;
+        this->resize(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            is >> metres;
+            setGene((*this)[i], metres);
+        }
+    }
+};
+
+// eoRealInitBounded for quantized genomes
+template <class EOT>
+class hadQuantizedInit : public eoInit<EOT>
+{
+public:
+    hadQuantizedInit(eoRealVectorBounds& _bounds)
+        : bounds(_bounds)
+    {}
+
+    void operator()(EOT& g)
+    {
+        vector<double> genome(bounds.size());
+        bounds.uniform(genome);
+
+        g.resize(genome.size());
+        setGenome(g, genome);
+        g.invalidate();
+    }
+
+private:
+    eoRealVectorBounds& bounds;
+};
+
+#endif
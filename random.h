@@ -0,0 +1,86 @@
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+// Source of uniform numbers for operators, so they can draw either from
+// EO's global rng or from a stream of their own
+
+class RandomStream {
+public:
+    virtual ~RandomStream()
+    {}
+
+    // in [0, 1)
+    virtual double uniform() = 0;
+
+    inline bool flip(double p)
+    {
+        return uniform() < p;
+    }
+
+    inline double uniform(double max)
+    {
+        return max * uniform();
+    }
+};
+
+
+// Counter based stream (Philox4x32-10, Salmon et al. 2011). Numbers depend
+// only on (seed, generation, index) and their position in the stream, so an
+// individual gets the same numbers on whatever thread it is bred.
+
+class PhiloxStream : public RandomStream {
+public:
+    PhiloxStream(uint32_t seed = 0, uint32_t generation = 0, uint32_t index = 0)
+    {
+        reset(seed, generation, index);
+    }
+
+    void reset(uint32_t seed, uint32_t generation, uint32_t index)
+    {
+        key[0] = seed; key[1] = 0x48414400; // "HAD"
+        counter[0] = 0; counter[1] = 0;
+        counter[2] = index; counter[3] = generation;
+        position = 4;
+    }
+
+    inline uint32_t next()
+    {
+        if (position == 4)
+        {
+            block(counter, key, output);
+            if (++counter[0] == 0) counter[1]++;
+            position = 0;
+        }
+        return output[position++];
+    }
+
+    double uniform()
+    {
+        return next() * (1.0 / 4294967296.0);
+    }
+
+    static void block(const uint32_t* in, const uint32_t* k, uint32_t* out)
+    {
+        const uint32_t m0 = 0xD2511F53, m1 = 0xCD9E8D57, w0 = 0x9E3779B9, w1 = 0xBB67AE85;
+
+        uint32_t c[4] = {in[0], in[1], in[2], in[3]}, k0 = k[0], k1 = k[1];
+        for (int round = 0; round < 10; round++)
+        {
+            uint64_t p0 = uint64_t(m0) * c[0], p1 = uint64_t(m1) * c[2];
+            uint32_t r0 = uint32_t(p1 >> 32) ^ c[1] ^ k0, r1 = uint32_t(p1),
+                     r2 = uint32_t(p0 >> 32) ^ c[3] ^ k1, r3 = uint32_t(p0);
+            c[0] = r0; c[1] = r1; c[2] = r2; c[3] = r3;
+            k0 += w0; k1 += w1;
+        }
+        out[0] = c[0]; out[1] = c[1]; out[2] = c[2]; out[3] = c[3];
+    }
+
+private:
+    uint32_t key[2], counter[4], output[4];
+    int position;
+};
+
+#endif
@@ -0,0 +1,107 @@
+
+#ifndef REPAIR_H
+#define REPAIR_H
+
+// needs evaluate.h to be included before
+
+// None: plans are evaluated as they are, Lamarckian: repaired plan replaces
+// offspring, Baldwinian: offspring keeps its genes and gets repaired value
+enum RepairMode { NoRepair, Lamarckian, Baldwinian };
+
+const int repairPasses = 16;
+
+// genes of a room moved into [low, high - length]
+inline void clampRoom(double& position, double length, double low, double high)
+{
+    if (position + length > high) position = high - length;
+    if (position < low) position = low;
+}
+
+struct GeneLess {
+    const vector<double>& genome;
+    bool operator()(int a, int b) const { return genome[4*a] < genome[4*b]; }
+};
+
+
+// Repair
+
+// moves plan toward feasibility: stairs and elevator get their fixed size,
+// rooms are clamped into space, then overlapping rooms are pushed apart by
+// minimum translations along axis of smaller overlap. Other sizes are kept,
+// area penalty scores a clipped area that a shrunk room would fall short of
+void repairPlan(House* house, vector<double>& genome)
+{
+    TRACE_ZONE("repair");
+
+    const double minLength = 1; // door width
+    const size_t rooms = house->rooms;
+    Rect& space = house->space;
+    double width = space.getWidth(), height = space.getHeight();
+
+    // sizes and boundary
+    for (size_t i = 0; i < rooms; i++)
+    {
+        double* g = &genome[4*i];
+
+        // flipped rooms
+        if (g[2] < 0) { g[0] += g[2]; g[2] = -g[2]; }
+        if (g[3] < 0) { g[1] += g[3]; g[3] = -g[3]; }
+
+        const Size& limit = house->room[i].sizeLimit;
+        if (limit.width)
+        {
+            double w = limit.width + house->wall, h = limit.height + house->wall;
+            if (fabs(g[2] - w) + fabs(g[3] - h) > fabs(g[2] - h) + fabs(g[3] - w))
+                swap(w, h);
+
+            // around same center
+            g[0] += (g[2] - w) / 2; g[1] += (g[3] - h) / 2;
+            g[2] = w; g[3] = h;
+        }
+
+        g[2] = min(max(g[2], minLength), width);
+        g[3] = min(max(g[3], minLength), height);
+        clampRoom(g[0], g[2], space.x1, space.x2);
+        clampRoom(g[1], g[3], space.y1, space.y2);
+    }
+
+    // overlaps, sweep and prune over x in each pass
+    vector<int> order(rooms);
+    for (int pass = 0; pass < repairPasses; pass++)
+    {
+        for (size_t i = 0; i < rooms; i++)
+            order[i] = i;
+        GeneLess less = {genome};
+        sort(order.begin(), order.end(), less);
+
+        bool moved = false;
+        for (size_t b, a = 0; a < rooms; a++)
+            for (b = a+1; b < rooms && genome[4*order[b]] < genome[4*order[a]] + genome[4*order[a]+2]; b++)
+            {
+                double *g1 = &genome[4*order[a]], *g2 = &genome[4*order[b]];
+
+                double ox = min(g1[0] + g1[2], g2[0] + g2[2]) - max(g1[0], g2[0]),
+                       oy = min(g1[1] + g1[3], g2[1] + g2[3]) - max(g1[1], g2[1]);
+                if (ox <= 0 || oy <= 0)
+                    continue;
+
+                // half of overlap for each room, away from each other, and
+                // what first room could not move for second one
+                int axis = ox < oy ? 0 : 1;
+                double overlap = axis ? oy : ox, sign = 1;
+                if (g1[axis] + g1[axis+2] / 2 > g2[axis] + g2[axis+2] / 2)
+                    sign = -1;
+
+                double low = axis ? space.y1 : space.x1, high = axis ? space.y2 : space.x2, last = g1[axis];
+                g1[axis] -= sign * overlap / 2;
+                clampRoom(g1[axis], g1[axis+2], low, high);
+                g2[axis] += sign * (overlap - fabs(g1[axis] - last));
+                clampRoom(g2[axis], g2[axis+2], low, high);
+                moved = true;
+            }
+
+        if (! moved) break;
+    }
+}
+
+#endif
@@ -0,0 +1,166 @@
+
+#ifndef SAVER_H
+#define SAVER_H
+
+// needs eo and evaluate.h to be included before
+
+#include <pthread.h>
+#include <stdio.h>
+#include <sstream>
+#include <deque>
+
+#include "checkpoint.h"
+#include "compress.h"
+#include "trace.h"
+
+// Generation files written by a thread of their own. Every saveFrequency
+// generations the population is copied into a free snapshot, which keeps its
+// individuals between uses, and queued for writer thread to serialize,
+// compress and write as resDir/generations#.savz. With all snapshots
+// queued, disk is behind and next generation waits for a free one.
+
+template <class EOT>
+class hadAsyncSaver : public eoUpdater
+{
+public:
+    unsigned long generation; // of run, numbers files
+
+    hadAsyncSaver(const eoPop<EOT>& _pop, const string& _prefix, unsigned _frequency, unsigned _snapshots)
+        : generation(0), pop(_pop), prefix(_prefix), frequency(_frequency), stopped(false)
+    {
+        snapshots.resize(max(_snapshots, 1u));
+        for (size_t i = 0; i < snapshots.size(); i++)
+            spare.push_back(&snapshots[i]);
+
+        pthread_mutex_init(&mutex, 0);
+        pthread_cond_init(&changed, 0);
+        pthread_create(&thread, 0, run, this);
+    }
+
+    // writes queued snapshots before returning
+    ~hadAsyncSaver()
+    {
+        pthread_mutex_lock(&mutex);
+        stopped = true;
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&mutex);
+
+        pthread_join(thread, 0);
+        pthread_cond_destroy(&changed);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    void operator()()
+    {
+        generation++;
+        if (! frequency || generation % frequency)
+            return;
+
+        TRACE_ZONE("saveGeneration");
+
+        // backpressure
+        pthread_mutex_lock(&mutex);
+        while (spare.empty())
+            pthread_cond_wait(&changed, &mutex);
+
+        Snapshot* snapshot = spare.front();
+        spare.pop_front();
+        pthread_mutex_unlock(&mutex);
+
+        snapshot->generation = generation;
+        snapshot->pop = pop;
+
+        pthread_mutex_lock(&mutex);
+        queue.push_back(snapshot);
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    string className() const { return "hadAsyncSaver"; }
+
+private:
+    struct Snapshot {
+        unsigned long generation;
+        eoPop<EOT> pop;
+    };
+
+    const eoPop<EOT>& pop;
+    string prefix;
+    unsigned frequency;
+
+    vector<Snapshot> snapshots;
+    deque<Snapshot*> spare, queue;
+    bool stopped;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+
+    static void* run(void* saver)
+    {
+        ((hadAsyncSaver*) saver)->write();
+        return 0;
+    }
+
+    void write()
+    {
+        for (;;)
+        {
+            pthread_mutex_lock(&mutex);
+            while (queue.empty() && ! stopped)
+                pthread_cond_wait(&changed, &mutex);
+            if (queue.empty())
+            {
+                pthread_mutex_unlock(&mutex);
+                return;
+            }
+            Snapshot* snapshot = queue.front();
+            queue.pop_front();
+            pthread_mutex_unlock(&mutex);
+
+            // sections of eoState files
+            ostringstream text;
+            text << "\\section{eoPop}\n";
+            snapshot->pop.printOn(text);
+            text << "\n";
+            string content = lzCompress(text.str());
+
+            // readers see only complete files
+            ostringstream filename;
+            filename << prefix << snapshot->generation << ".savz";
+            string tmp = filename.str() + ".tmp";
+            FILE* file = fopen(tmp.c_str(), "wb");
+            bool written = file && fwrite(content.data(), 1, content.size(), file) == content.size();
+            written = file && fclose(file) == 0 && written;
+            if (! written || rename(tmp.c_str(), filename.str().c_str()) != 0)
+                cerr << "Could not write " << filename.str() << endl;
+
+            pthread_mutex_lock(&mutex);
+            spare.push_back(snapshot);
+            pthread_cond_broadcast(&changed);
+            pthread_mutex_unlock(&mutex);
+        }
+    }
+};
+
+// takes over saveFrequency of make_checkpoint, which then only saves final
+// state, so it has to be called before it
+template <class EOT>
+hadAsyncSaver<EOT>* do_make_async_saver(eoParser& _parser, eoState& _state, const eoPop<EOT>& _pop, hadRunState& _runState)
+{
+    bool async = _parser.createParam(true, "asyncSave", "Write compressed generation files in background", '\0', "Output - Disk").value();
+    if (! async)
+        return 0;
+
+    string resDir = _parser.getORcreateParam(string("Res"), "resDir", "Directory to store DISK outputs", '\0', "Output - Disk").value();
+    unsigned frequency = _parser.getORcreateParam(unsigned(0), "saveFrequency", "Save every F generation (0 = only final state, absent = never)", '\0', "Persistence").value();
+    unsigned snapshots = _parser.createParam(unsigned(4), "saveQueue", "Generation snapshots waiting to be written before run waits for disk", '\0', "Output - Disk").value();
+    _parser.setORcreateParam(unsigned(0), "saveFrequency", "Save every F generation (0 = only final state, absent = never)", '\0', "Persistence");
+
+    hadAsyncSaver<EOT>* saver = new hadAsyncSaver<EOT>(_pop, resDir + "/generations", frequency, snapshots);
+    _state.storeFunctor(saver);
+    _runState.addValue("saverGeneration", saver->generation);
+    return saver;
+}
+
+#endif
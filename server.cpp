@@ -0,0 +1,285 @@
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <deque>
+
+#include "evaluate.h"
+#include "client.h"
+
+// Evaluation server, problem loaded once and batches of genomes of clients
+// of client.h scored over a Unix domain socket
+// usage: server [--problem=problem.json] [--socket=had.sock] [--threads=0]
+//
+// Each connection has a thread of its own which reads its requests in
+// order, so pipelined requests wait in socket buffer, not in round trips.
+// Small batches are scored on connection thread, larger ones in chunks
+// claimed by workers of pool and connection thread alike, each on a house
+// of its own.
+
+const uint32_t chunkSize = 4; // genomes claimed at once
+const uint32_t inlineBatch = 8; // largest batch scored on connection thread only
+const size_t maxRequest = 1 << 24; // doubles of a request
+
+
+// Scoring
+
+inline void score(House* house, const double* genome, uint32_t genes, PlanScore& s)
+{
+    Evaluation e = evaluate(house, GENOME(genome, genes));
+    s.area = e.area; s.intersection = e.intersection; s.side = e.side;
+    s.access = e.access; s.space = e.space; s.light = e.light;
+    s.total = e.total;
+}
+
+struct Job {
+    const double* genomes;
+    PlanScore* scores;
+    uint32_t count, genes;
+    uint32_t claimed, done; // genomes
+    pthread_cond_t finished;
+};
+
+class Pool {
+public:
+    Pool(int threads)
+        : stopped(false)
+    {
+        pthread_mutex_init(&mutex, 0);
+        pthread_cond_init(&changed, 0);
+
+        workers.resize(threads);
+        for (int i = 0; i < threads; i++)
+        {
+            workers[i].pool = this;
+            workers[i].house = new House(*House::house);
+            pthread_create(&workers[i].thread, 0, run, &workers[i]);
+        }
+    }
+
+    ~Pool()
+    {
+        pthread_mutex_lock(&mutex);
+        stopped = true;
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&mutex);
+
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            pthread_join(workers[i].thread, 0);
+            delete workers[i].house;
+        }
+        pthread_cond_destroy(&changed);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    // scores job on workers, caller scores on house too
+    void operator()(Job& job, House* house)
+    {
+        job.claimed = job.done = 0;
+        pthread_cond_init(&job.finished, 0);
+
+        pthread_mutex_lock(&mutex);
+        jobs.push_back(&job);
+        pthread_cond_broadcast(&changed);
+
+        uint32_t first, last;
+        while (claim(job, first, last))
+        {
+            pthread_mutex_unlock(&mutex);
+            for (uint32_t i = first; i < last; i++)
+                score(house, job.genomes + size_t(i) * job.genes, job.genes, job.scores[i]);
+            pthread_mutex_lock(&mutex);
+            job.done += last - first;
+        }
+
+        while (job.done < job.count)
+            pthread_cond_wait(&job.finished, &mutex);
+        pthread_mutex_unlock(&mutex);
+        pthread_cond_destroy(&job.finished);
+    }
+
+private:
+    struct Worker {
+        Pool* pool;
+        House* house;
+        pthread_t thread;
+    };
+
+    vector<Worker> workers;
+    deque<Job*> jobs; // with genomes to claim
+    bool stopped;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+
+    static void* run(void* worker)
+    {
+        Worker* w = (Worker*) worker;
+        w->pool->work(w->house);
+        return 0;
+    }
+
+    // next chunk of job, with mutex locked
+    bool claim(Job& job, uint32_t& first, uint32_t& last)
+    {
+        if (job.claimed >= job.count)
+            return false;
+
+        first = job.claimed;
+        last = min(first + chunkSize, job.count);
+        job.claimed = last;
+        if (last == job.count)
+            jobs.erase(find(jobs.begin(), jobs.end(), &job));
+        return true;
+    }
+
+    void work(House* house)
+    {
+        uint32_t first, last;
+        pthread_mutex_lock(&mutex);
+        for (;;)
+        {
+            while (! stopped && jobs.empty())
+                pthread_cond_wait(&changed, &mutex);
+            if (stopped)
+                break;
+
+            Job& job = *jobs.front();
+            claim(job, first, last);
+            pthread_mutex_unlock(&mutex);
+
+            for (uint32_t i = first; i < last; i++)
+                score(house, job.genomes + size_t(i) * job.genes, job.genes, job.scores[i]);
+
+            pthread_mutex_lock(&mutex);
+            job.done += last - first;
+            if (job.done == job.count)
+                pthread_cond_signal(&job.finished);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+};
+
+
+// Connections
+
+struct Connection {
+    int socket;
+    Pool* pool;
+};
+
+void* serve(void* connection)
+{
+    Connection* c = (Connection*) connection;
+    House house(*House::house);
+    const uint32_t genes = 4 * house.rooms;
+
+    vector<double> genomes;
+    vector<PlanScore> scores;
+    FrameHeader request;
+    while (receiveFull(c->socket, &request, sizeof(request)) && request.magic == frameMagic)
+    {
+        size_t size = size_t(request.count) * request.genes;
+        if (size > maxRequest)
+            break;
+        genomes.resize(size);
+        if (size && ! receiveFull(c->socket, &genomes[0], size * sizeof(double)))
+            break;
+
+        FrameHeader response = {frameMagic, request.id, request.genes == genes ? request.count : 0, genes};
+        scores.resize(response.count);
+        if (response.count <= inlineBatch)
+        {
+            for (uint32_t i = 0; i < response.count; i++)
+                score(&house, &genomes[size_t(i) * genes], genes, scores[i]);
+        }
+        else
+        {
+            Job job;
+            job.genomes = &genomes[0]; job.scores = &scores[0];
+            job.count = response.count; job.genes = genes;
+            (*c->pool)(job, &house);
+        }
+
+        if (! sendFrame(c->socket, response, response.count ? &scores[0] : 0, response.count * sizeof(PlanScore)))
+            break;
+    }
+
+    close(c->socket);
+    delete c;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    string problem, path = "had.sock";
+    int threads = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i], value = arg.substr(arg.find('=') + 1);
+        if (arg.find("--problem=") == 0) problem = value;
+        else if (arg.find("--socket=") == 0) path = value;
+        else if (arg.find("--threads=") == 0) threads = atoi(value.c_str());
+        else
+        {
+            printf("usage: server [--problem=problem.json] [--socket=had.sock] [--threads=0]\n");
+            return 1;
+        }
+    }
+
+    if (problem.size() && ! House::house->load(problem.c_str()))
+    {
+        printf("could not read problem %s\n", problem.c_str());
+        return 1;
+    }
+    if (threads <= 0)
+        threads = max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        printf("socket path is too long\n");
+        return 1;
+    }
+    strcpy(address.sun_path, path.c_str());
+
+    signal(SIGPIPE, SIG_IGN);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 || bind(listener, (sockaddr*) &address, sizeof(address)) < 0 || listen(listener, 64) < 0)
+    {
+        perror("server");
+        return 1;
+    }
+
+    // connection thread scores too
+    Pool pool(threads - 1);
+    printf("scoring %lu rooms on %d threads at %s\n", (unsigned long) House::house->rooms, threads, path.c_str());
+    fflush(stdout);
+
+    for (;;)
+    {
+        int socket = accept(listener, 0, 0);
+        if (socket < 0)
+            continue;
+
+        Connection* connection = new Connection;
+        connection->socket = socket;
+        connection->pool = &pool;
+
+        pthread_t thread;
+        if (pthread_create(&thread, 0, serve, connection) == 0)
+            pthread_detach(thread);
+        else
+        {
+            close(socket);
+            delete connection;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# Evaluation server of plans over a Unix domain socket
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = server
+CONFIG   += console
+CONFIG   -= app_bundle qt
+TEMPLATE = app
+
+LIBS += -lpthread
+
+
+SOURCES += server.cpp
+
+HEADERS  += evaluate.h \
+    client.h \
+    telemetry.h \
+    json.h \
+    genome.h \
+    trace.h
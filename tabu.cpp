@@ -0,0 +1,171 @@
+
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <time.h>
+
+#include <eo>
+#include <es/make_es.h>
+#include <do/make_pop.h>
+#include <do/make_continue.h>
+#include <do/make_checkpoint.h>
+#include <do/make_run.h>
+
+using namespace std;
+
+#include "/home/alireza/repo/had/evaluate.h"
+#include "/home/alireza/repo/had/operators.h"
+#include "/home/alireza/repo/had/breeder.h"
+#include "/home/alireza/repo/had/saver.h"
+
+
+// Algorithm
+
+// tabu search from best individual of initial population, a step per
+// generation of checkpoint, population is best plan of search so far.
+// Search is part of run state, moves of a step are drawn from stream of
+// its generation, so a resumed run goes on as the whole run. Moves are
+// scored as population is, repaired by mode, and evaluations are counted
+// on houses of search.
+template <class EOT>
+class hadTabuAlgo : public eoAlgo<EOT>, public eoPersistent
+{
+public:
+    hadTabuAlgo(eoPop<EOT>& _pop, eoContinue<EOT>& _continue, eoValueParam<unsigned long>& _counter, uint32_t _seed, const unsigned long& _generation, unsigned _moves, unsigned _tenure, double _step, RepairMode _mode)
+        : continuator(_continue), counter(_counter), seed(_seed), generation(_generation), telemetries(threadCount())
+    {
+        // telemetry of each thread if House::house has one
+        for (int i = 0; i < threadCount(); i++)
+        {
+            houses.push_back(new House(*House::house));
+            houses.back()->telemetry = House::house->telemetry ? &telemetries[i] : 0;
+        }
+
+        // evaluation of start plan is counted with first step
+        _pop.sort();
+        _pop.resize(1);
+        counted = evaluations();
+        tabu = new TabuSearch(houses, genomeMetres(_pop[0]), random, _moves, _tenure, _step, _mode);
+    }
+
+    ~hadTabuAlgo()
+    {
+        delete tabu;
+        for (size_t i = 0; i < houses.size(); i++)
+            delete houses[i];
+    }
+
+    void operator()(eoPop<EOT>& pop)
+    {
+        do
+        {
+            random.reset(seed, generation, 0);
+            (*tabu)();
+
+            unsigned long total = evaluations();
+            counter.value() += total - counted;
+            counted = total;
+            if (House::house->telemetry)
+                for (size_t i = 0; i < houses.size(); i++)
+                    House::house->telemetry->collect(telemetries[i]);
+
+            setGenome(pop[0], tabu->best);
+            pop[0].fitness(tabu->bestValue);
+        } while (continuator(pop));
+    }
+
+    void printOn(ostream& os) const { tabu->printOn(os); }
+    void readFrom(istream& is) { tabu->readFrom(is); }
+
+private:
+    eoContinue<EOT>& continuator;
+    eoValueParam<unsigned long>& counter;
+    uint32_t seed;
+    const unsigned long& generation;
+    vector<Telemetry> telemetries; // of houses
+    vector<House*> houses;
+    PhiloxStream random;
+    TabuSearch* tabu;
+    unsigned long counted; // evaluations of houses in counter
+
+    // of moves scored so far
+    unsigned long evaluations() const
+    {
+        unsigned long sum = 0;
+        for (size_t i = 0; i < houses.size(); i++)
+            sum += houses[i]->evaluations;
+        return sum;
+    }
+};
+
+typedef eoMinimizingFitness FitT;
+typedef eoReal<FitT> HAD;
+
+int main_function(int argc, char *argv[])
+{
+    eoParser parser(argc, argv); // for user-parameter reading
+    eoState state; // keeps all things allocated
+
+    // The evaluation fn - encapsulated into an eval counter for output
+    RepairMode repair = do_make_repair(parser);
+    hadScalarEval<HAD> mainEval(repair);
+    eoEvalFuncCounter<HAD> eval(mainEval);
+
+    do_make_problem(parser);
+    hadRunState runState(parser);
+    eoInit<HAD>& init = make_genotype(parser, state, HAD());
+
+    // search starts from best of initial population
+    eoPop<HAD>& pop = do_make_pop(parser, state, init);
+    runState.add("population", pop);
+    runState.addValue("evaluations", eval.value());
+    apply<HAD>(eval, pop);
+
+    unsigned moves = parser.createParam(unsigned(20), "tabuMoves", "Moves scored in each step of tabu search", '\0', "Evolution Engine").value();
+    unsigned tenure = parser.createParam(unsigned(7), "tabuTenure", "Steps a reverse of taken move stays tabu", '\0', "Evolution Engine").value();
+    double step = parser.createParam(0.5, "tabuStep", "Largest shift or resize of a room in a move", '\0', "Evolution Engine").value();
+    uint32_t seed = parser.getORcreateParam(uint32_t(0), "seed", "Random number seed", '\0').value();
+    unsigned threads = parser.createParam(unsigned(0), "threads", "Number of threads scoring moves, 0 for all cores", '\0', "Evolution Engine").value();
+#ifdef _OPENMP
+    if (threads > 0) omp_set_num_threads(threads);
+#endif
+
+    eoContinue<HAD> & term = do_make_continue(parser, state, eval, runState);
+    hadAsyncSaver<HAD>* saver = do_make_async_saver(parser, state, pop, runState);
+    eoCheckPoint<HAD> & checkpoint = do_make_checkpoint(parser, state, eval, term);
+    if (saver) checkpoint.add(*saver);
+
+    // telemetry of run, next to generation files
+    string resDir = parser.getORcreateParam(string("Res"), "resDir", "Directory to store DISK outputs", '\0', "Output - Disk").value();
+    checkpoint.add(do_make_telemetry(parser, state, runState));
+
+    hadTabuAlgo<HAD> tabu(pop, checkpoint, eval, seed, runState.generation, moves, tenure, step, repair);
+    runState.add("tabu", tabu);
+
+    // full state after all other updaters and continuators of generation
+    hadRunStateContinue<HAD> runStateContinue(runState);
+    checkpoint.add(runStateContinue);
+
+    do_run(tabu, pop);
+    TRACE_WRITE((resDir + "/trace.json").c_str());
+
+    make_help(parser);
+    return 0;
+}
+
+// A main that catches the exceptions
+int main(int argc, char **argv)
+{
+    try
+    {
+        main_function(argc, argv);
+    }
+    catch(exception& e)
+    {
+        cout << "Exception: " << e.what() << '\n';
+    }
+
+    return 1;
+}
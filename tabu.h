@@ -0,0 +1,238 @@
+
+#ifndef TABU_H
+#define TABU_H
+
+// needs evaluate.h to be included before
+
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+
+#include "random.h"
+#include "trace.h"
+#include "repair.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Tabu search (Glover 1989) over moves of rooms: a shift of a room by up to
+// step in x and y, a resize of it by up to step in width and height about
+// its centre, or a swap of centres of two rooms as RoomSwapMutation. Each
+// step draws a set of moves, scores them all in one batched call and takes
+// best admissible one even if it is worse than current plan, so search
+// leaves plateaus and local optima. A taken move makes its reverse tabu for
+// tenure steps; tabu moves are admissible only if they beat best plan so
+// far (aspiration).
+//
+// Tabu attributes are kept in a hashed table of expiry steps, so a move is
+// checked in O(1); attributes sharing a slot are both tabu. Moves are
+// scored on a house per thread, in order of moves, so search does not
+// depend on number of threads. Plans have no incremental evaluation, so
+// each move is applied to a copy of plan and scored in full, repaired by
+// mode as hadScalarEval does.
+
+struct TabuMove {
+    enum Kind { Shift, Resize, Swap };
+
+    int kind, room, other;
+    double dx, dy;
+
+    // attribute of move, reverse of it for Shift and Resize
+    uint64_t attribute(bool reverse = false) const
+    {
+        int signs = kind == Swap ? 0 : (dx > 0) + 2 * (dy > 0);
+        if (reverse && kind != Swap)
+            signs = 3 - signs;
+
+        uint64_t key = ((uint64_t(kind) * 1000003 + room) * 1000003 + other) * 4 + signs;
+        return key * 0x9E3779B97F4A7C15ull;
+    }
+
+    void apply(double* genome) const
+    {
+        double* r = genome + 4 * room;
+        if (kind == Shift)
+        {
+            r[0] += dx; r[1] += dy;
+        }
+        else if (kind == Resize)
+        {
+            r[0] -= dx / 2; r[1] -= dy / 2;
+            r[2] += dx; r[3] += dy;
+        }
+        else
+        {
+            double* s = genome + 4 * other;
+            double x1 = s[0] + (s[2] - r[2]) / 2, y1 = s[1] + (s[3] - r[3]) / 2,
+                   x2 = r[0] + (r[2] - s[2]) / 2, y2 = r[1] + (r[3] - s[3]) / 2;
+            r[0] = x1; r[1] = y1;
+            s[0] = x2; s[1] = y2;
+        }
+    }
+};
+
+class TabuSearch {
+public:
+    vector<double> genome, best;
+    double value, bestValue;
+    unsigned long steps;
+
+    // houses of threads scoring moves, one for a caller already on a thread of its own
+    TabuSearch(const vector<House*>& _houses, GENOME _genome, RandomStream& _random, unsigned _moves = 20, unsigned _tenure = 7, double _step = 0.5, RepairMode _mode = NoRepair)
+        : genome(_genome.begin(), _genome.end()), steps(0), houses(_houses), random(_random), moves(_moves), tenure(_tenure), step(_step), mode(_mode)
+    {
+        value = bestValue = evaluatePlan(houses[0], &genome[0]);
+        best = genome;
+        expiries.assign(tableSize, 0);
+    }
+
+    // returns false if no move is admissible
+    bool operator()()
+    {
+        TRACE_ZONE("tabuStep");
+
+        draw();
+        score();
+
+        int chosen = -1;
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            bool tabu = expiries[slot(candidates[i].attribute())] > steps;
+            if ((! tabu || values[i] < bestValue) && (chosen < 0 || values[i] < values[chosen]))
+                chosen = i;
+        }
+
+        steps++;
+        if (chosen < 0)
+            return false;
+
+        // plan as scored, repaired if Lamarckian
+        const TabuMove& move = candidates[chosen];
+        copy(plans.begin() + genome.size() * chosen, plans.begin() + genome.size() * (chosen + 1), genome.begin());
+        value = values[chosen];
+        expiries[slot(move.attribute(true))] = steps + tenure;
+
+        if (value < bestValue)
+        {
+            best = genome;
+            bestValue = value;
+        }
+        return true;
+    }
+
+    // plans, step and tabu attributes of search, to resume it
+    void printOn(ostream& os) const
+    {
+        os << genome.size();
+        for (size_t i = 0; i < genome.size(); i++)
+            os << ' ' << genome[i] << ' ' << best[i];
+        os << ' ' << value << ' ' << bestValue << ' ' << steps;
+
+        size_t count = 0;
+        for (size_t i = 0; i < expiries.size(); i++)
+            count += expiries[i] > steps;
+        os << ' ' << count;
+        for (size_t i = 0; i < expiries.size(); i++)
+            if (expiries[i] > steps)
+                os << ' ' << i << ' ' << expiries[i];
+    }
+
+    void readFrom(istream& is)
+    {
+        size_t size, count, slot;
+        is >> size;
+        genome.resize(size);
+        best.resize(size);
+        for (size_t i = 0; i < size; i++)
+            is >> genome[i] >> best[i];
+        is >> value >> bestValue >> steps >> count;
+
+        expiries.assign(tableSize, 0);
+        for (size_t i = 0; i < count && is >> slot; i++)
+            is >> expiries[slot % tableSize];
+    }
+
+private:
+    static const size_t tableSize = 1 << 12;
+
+    vector<House*> houses;
+    RandomStream& random;
+    unsigned moves, tenure;
+    double step;
+    RepairMode mode;
+
+    vector<uint64_t> expiries; // step when attribute is no longer tabu
+    vector<TabuMove> candidates;
+    vector<double> plans, values; // of candidates
+
+    static size_t slot(uint64_t attribute)
+    {
+        return attribute >> 52; // top 12 bits of multiplicative hash
+    }
+
+    void draw()
+    {
+        const int rooms = houses[0]->rooms;
+        candidates.resize(moves);
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            TabuMove& move = candidates[i];
+            move.kind = rooms > 1 ? int(random.uniform(3)) : int(random.uniform(2));
+            move.room = int(random.uniform(rooms));
+            move.other = 0;
+            move.dx = move.dy = 0;
+
+            if (move.kind == TabuMove::Swap)
+            {
+                move.other = int(random.uniform(rooms - 1));
+                if (move.other >= move.room) move.other++;
+                if (move.other < move.room) swap(move.room, move.other);
+            }
+            else
+            {
+                move.dx = step * (2 * random.uniform() - 1);
+                move.dy = step * (2 * random.uniform() - 1);
+            }
+        }
+    }
+
+    // all candidates in one call, each applied to a copy of plan
+    // value of plan, as of hadScalarEval: a Lamarckian repair replaces it
+    double evaluatePlan(House* house, double* plan) const
+    {
+        if (mode == NoRepair)
+            return real_value(house, GENOME(plan, genome.size()));
+
+        vector<double> repaired(plan, plan + genome.size());
+        repairPlan(house, repaired);
+        if (mode == Lamarckian)
+            copy(repaired.begin(), repaired.end(), plan);
+        return real_value(house, repaired);
+    }
+
+    void score()
+    {
+        const size_t genes = genome.size(), count = candidates.size();
+        plans.resize(genes * count);
+        values.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            copy(genome.begin(), genome.end(), plans.begin() + genes * i);
+            candidates[i].apply(&plans[genes * i]);
+        }
+
+        // a team of houses, as threads may have changed since they were made
+        #pragma omp parallel for schedule(dynamic) num_threads(houses.size()) if(houses.size() > 1)
+        for (int i = 0; i < int(count); i++)
+        {
+            int thread = 0;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+#endif
+            values[i] = evaluatePlan(houses[thread], &plans[genes * i]);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,128 @@
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdio.h>
+#include <time.h>
+
+#include "trace.h"
+
+// Counters of a run, written as one csv row per generation
+
+class Telemetry {
+public:
+    // update: rects of plan, adjacency graph, room overlaps and side distances
+    enum Component { Update, Area, Intersection, Side, Spaces, Access, Light, Space, Components };
+
+    int generation;
+    unsigned long evaluations, localSearchSteps;
+    double componentTime[Components]; // seconds, summed over threads
+
+    // latest of background indicator, its generation is -1 if there is none
+    int hypervolumeGeneration;
+    double hypervolume, hypervolumeError;
+
+    // genotype spread of population (m), renewals of collapsed population
+    double geneDeviation, centroidDistance;
+    unsigned long restarts;
+
+    Telemetry()
+        : generation(0), hypervolumeGeneration(-1), hypervolume(0), hypervolumeError(0), geneDeviation(0), centroidDistance(0), restarts(0), file(0)
+    {
+        reset();
+        start = last = now();
+    }
+
+    ~Telemetry()
+    {
+        if (file) fclose(file);
+    }
+
+    static double now()
+    {
+        timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + t.tv_nsec * 1e-9;
+    }
+
+    void reset()
+    {
+        evaluations = localSearchSteps = 0;
+        for (int i = 0; i < Components; i++)
+            componentTime[i] = 0;
+    }
+
+    // counters of a thread's telemetry, which starts over
+    void collect(Telemetry& thread)
+    {
+        evaluations += thread.evaluations;
+        localSearchSteps += thread.localSearchSteps;
+        for (int i = 0; i < Components; i++)
+            componentTime[i] += thread.componentTime[i];
+        thread.reset();
+    }
+
+    // appends to rows of a resumed run
+    bool open(const char* filename, bool append = false)
+    {
+        file = fopen(filename, append ? "a" : "w");
+        if (! file) return false;
+
+        if (! append || ftell(file) == 0)
+            fprintf(file, "generation,time,evaluations,evaluationsPerSecond,generationTime,update,area,intersection,side,spaces,access,light,space,localSearchSteps,hypervolume,hypervolumeError,hypervolumeGeneration,geneDeviation,centroidDistance,restarts\n");
+        fflush(file);
+        return true;
+    }
+
+    // closes counters of current generation
+    void nextGeneration()
+    {
+        TRACE_ZONE("telemetry");
+
+        double current = now(), elapsed = current - last;
+
+        if (file)
+        {
+            fprintf(file, "%d,%.3f,%lu,%.1f,%.6f", generation, current - start, evaluations, elapsed > 0 ? evaluations / elapsed : 0, elapsed);
+            for (int i = 0; i < Components; i++)
+                fprintf(file, ",%.6f", componentTime[i]);
+            fprintf(file, ",%lu", localSearchSteps);
+            if (hypervolumeGeneration >= 0)
+                fprintf(file, ",%.9g,%.3g,%d", hypervolume, hypervolumeError, hypervolumeGeneration);
+            else
+                fprintf(file, ",,,");
+            fprintf(file, ",%.6g,%.6g,%lu\n", geneDeviation, centroidDistance, restarts);
+            fflush(file);
+        }
+
+        generation++;
+        last = current;
+        reset();
+    }
+
+private:
+    double start, last;
+    FILE* file;
+};
+
+// adds its lifetime to a component, does nothing without telemetry
+class TelemetryTimer {
+public:
+    TelemetryTimer(Telemetry* _telemetry, Telemetry::Component _component)
+        : telemetry(_telemetry), component(_component), start(0)
+    {
+        if (telemetry) start = Telemetry::now();
+    }
+
+    ~TelemetryTimer()
+    {
+        if (telemetry) telemetry->componentTime[component] += Telemetry::now() - start;
+    }
+
+private:
+    Telemetry* telemetry;
+    Telemetry::Component component;
+    double start;
+};
+
+#endif
@@ -0,0 +1,149 @@
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped trace zones, compiled in only with HAD_TRACE defined. Each thread
+// records its latest zones into a buffer of its own without locks, Trace::write
+// exports them as Chrome trace json for chrome://tracing or Perfetto.
+//
+//  TRACE_ZONE("name");        // until end of scope, name must be a literal
+//  TRACE_WRITE("trace.json");
+
+#ifdef HAD_TRACE
+
+#include <stdio.h>
+#include <time.h>
+
+namespace Trace {
+
+struct Event {
+    const char* name;
+    double start, duration; // microseconds
+};
+
+// ring of latest events of a thread, older ones are dropped so a long run
+// keeps a bounded buffer. Events are only written by owner thread, count
+// is published after event.
+struct Buffer {
+    static const unsigned long capacity = 1 << 18;
+    int thread;
+    Event* events;
+    volatile unsigned long count; // recorded so far
+    Buffer* next;
+};
+
+inline double now()
+{
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec * 1e-3;
+}
+
+inline Buffer*& buffers()
+{
+    static Buffer* head = 0;
+    return head;
+}
+
+// buffer of calling thread, added to list of buffers on first use
+inline Buffer* local()
+{
+    static __thread Buffer* buffer = 0;
+    static int threads = 0;
+
+    if (! buffer)
+    {
+        Buffer* b = new Buffer;
+        b->thread = __sync_add_and_fetch(&threads, 1);
+        b->events = new Event[Buffer::capacity];
+        b->count = 0;
+
+        do b->next = buffers();
+        while (! __sync_bool_compare_and_swap(&buffers(), b->next, b));
+        buffer = b;
+    }
+    return buffer;
+}
+
+inline void record(const char* name, double start, double duration)
+{
+    Buffer* buffer = local();
+
+    Event& event = buffer->events[buffer->count % Buffer::capacity];
+    event.name = name; event.start = start; event.duration = duration;
+
+    __sync_synchronize();
+    buffer->count++;
+}
+
+// events recorded so far, threads may go on recording. Events are copied
+// first, those a thread overwrote meanwhile are left out.
+inline bool write(const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (! file) return false;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool first = true;
+    Event* events = new Event[Buffer::capacity];
+    for (Buffer* buffer = buffers(); buffer; buffer = buffer->next)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}", first ? "" : ",\n", buffer->thread, buffer->thread);
+        first = false;
+
+        unsigned long end = buffer->count;
+        __sync_synchronize();
+        unsigned long begin = end > Buffer::capacity ? end - Buffer::capacity : 0;
+        for (unsigned long i = begin; i < end; i++)
+            events[i % Buffer::capacity] = buffer->events[i % Buffer::capacity];
+
+        // event of count may be in writing, over one of a ring before
+        __sync_synchronize();
+        unsigned long count = buffer->count;
+        if (count + 1 > Buffer::capacity && count + 1 - Buffer::capacity > begin)
+            begin = count + 1 - Buffer::capacity;
+
+        for (unsigned long i = begin; i < end; i++)
+        {
+            const Event& event = events[i % Buffer::capacity];
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"had\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}", event.name, event.start, event.duration, buffer->thread);
+        }
+    }
+    delete[] events;
+
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+
+class Zone {
+public:
+    Zone(const char* _name)
+        : name(_name), start(now())
+    {}
+
+    ~Zone()
+    {
+        record(name, start, now() - start);
+    }
+
+private:
+    const char* name;
+    double start;
+};
+
+}
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_WRITE(filename) Trace::write(filename)
+
+#else
+
+#define TRACE_ZONE(name)
+#define TRACE_WRITE(filename)
+
+#endif
+
+#endif